@@ -0,0 +1,163 @@
+// BackgroundQueue.h
+//
+// Runs a function over queued jobs on a few detached worker threads and hands the results back to the main thread.
+// The header prober, stat fetcher and folder tree are all built on it.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <Foundation/tList.h>
+#include <Math/tFundamentals.h>
+
+
+// Job and Result are tLink types. Workers are started as jobs arrive, up to maxWorkers, and exit when the queue runs
+// dry. They are detached and hold their own reference to the shared state, so nothing here ever blocks the main
+// thread. Cancelling just flags that state and lets go of it. The workers notice between jobs and exit on their own,
+// and a new batch of jobs may be added straight away. The work function is called on the worker threads with a
+// default constructed result to fill in. Anything it uses must outlive the workers.
+template<typename Job, typename Result> class BackgroundQueue
+{
+public:
+	typedef std::function<void(Result&, const Job&)> WorkFn;
+	BackgroundQueue(int maxWorkers, const WorkFn& work)																	: MaxWorkers(maxWorkers), DoWork(work) { }
+	~BackgroundQueue()																									{ Cancel(); }
+
+	// Takes ownership of the job or moves the jobs out of the list.
+	void Add(Job*);
+	void Add(tList<Job>& jobs);
+	void Cancel();
+
+	// Moves up to maxResults results into results, or all of them if maxResults is negative. Returns true once nothing
+	// is queued, being worked on, or waiting to be taken, after which IsActive returns false until more jobs are added.
+	bool TakeResults(tList<Result>& results, int maxResults = -1);
+	bool IsActive() const																								{ return bool(Current); }
+
+private:
+	BackgroundQueue(const BackgroundQueue&) = delete;
+	BackgroundQueue& operator=(const BackgroundQueue&) = delete;
+
+	struct State
+	{
+		std::mutex Mutex;
+		tList<Job> Pending;
+		tList<Result> Results;
+		int NumWorkers						= 0;
+		std::atomic<bool> Cancelled			{ false };
+		WorkFn DoWork;
+	};
+	void StartWorkers(tList<Job>& jobs);
+	static void Work(std::shared_ptr<State>);
+
+	const int MaxWorkers;
+	const WorkFn DoWork;
+	std::shared_ptr<State> Current;
+};
+
+
+// Implementation below this line.
+
+
+template<typename Job, typename Result> inline void BackgroundQueue<Job, Result>::Add(Job* job)
+{
+	tList<Job> jobs;
+	jobs.Append(job);
+	StartWorkers(jobs);
+}
+
+
+template<typename Job, typename Result> inline void BackgroundQueue<Job, Result>::Add(tList<Job>& jobs)
+{
+	if (!jobs.IsEmpty())
+		StartWorkers(jobs);
+}
+
+
+template<typename Job, typename Result> inline void BackgroundQueue<Job, Result>::StartWorkers(tList<Job>& jobs)
+{
+	if (!Current)
+	{
+		Current = std::make_shared<State>();
+		Current->DoWork = DoWork;
+	}
+
+	int numToStart = 0;
+	{
+		std::lock_guard<std::mutex> lock(Current->Mutex);
+		while (!jobs.IsEmpty())
+			Current->Pending.Append(jobs.Remove());
+
+		int numWanted = tMath::tMin(MaxWorkers, Current->Pending.Count());
+		numToStart = tMath::tMax(numWanted - Current->NumWorkers, 0);
+		Current->NumWorkers += numToStart;
+	}
+
+	for (int w = 0; w < numToStart; w++)
+		std::thread(Work, Current).detach();
+}
+
+
+template<typename Job, typename Result> inline void BackgroundQueue<Job, Result>::Cancel()
+{
+	if (!Current)
+		return;
+
+	Current->Cancelled = true;
+	Current.reset();
+}
+
+
+template<typename Job, typename Result> inline bool BackgroundQueue<Job, Result>::TakeResults(tList<Result>& results, int maxResults)
+{
+	if (!Current)
+		return true;
+
+	bool done = false;
+	{
+		std::lock_guard<std::mutex> lock(Current->Mutex);
+		for (int r = 0; ((maxResults < 0) || (r < maxResults)) && !Current->Results.IsEmpty(); r++)
+			results.Append(Current->Results.Remove());
+		done = Current->Results.IsEmpty() && Current->Pending.IsEmpty() && (Current->NumWorkers == 0);
+	}
+
+	if (done)
+		Current.reset();
+	return done;
+}
+
+
+template<typename Job, typename Result> inline void BackgroundQueue<Job, Result>::Work(std::shared_ptr<State> state)
+{
+	while (true)
+	{
+		Job* job = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(state->Mutex);
+			if (state->Cancelled || state->Pending.IsEmpty())
+			{
+				state->NumWorkers--;
+				return;
+			}
+			job = state->Pending.Remove();
+		}
+
+		Result* result = new Result;
+		state->DoWork(*result, *job);
+		delete job;
+
+		std::lock_guard<std::mutex> lock(state->Mutex);
+		state->Results.Append(result);
+	}
+}
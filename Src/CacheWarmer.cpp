@@ -0,0 +1,177 @@
+// CacheWarmer.cpp
+//
+// Fills the thumbnail cache for a whole folder tree without opening a window. Meant to be run when new images are
+// ingested so the content view is already fast the first time anyone browses them.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <Math/tFundamentals.h>
+#include <System/tTime.h>
+#include <System/tMachine.h>
+#include "CacheWarmer.h"
+#include "DirScan.h"
+#include "TreeScanner.h"
+#include "Image.h"
+using namespace tMath;
+
+
+namespace
+{
+	struct WarmState
+	{
+		std::mutex Mutex;
+		tList<tStringItem> Pending;
+		tList<tStringItem> Failed;
+		bool WalkDone						= false;
+		std::atomic<int> NumWorkers			{ 0 };
+		std::atomic<int> NumGenerated		{ 0 };
+		std::atomic<int> NumCached			{ 0 };
+		std::atomic<int> NumSkipped			{ 0 };
+		std::atomic<int> NumFailed			{ 0 };
+		std::atomic<int64> NumBytesRead		{ 0 };		// Source bytes of the generated thumbnails only.
+	};
+
+
+	void Work(WarmState* state, int level)
+	{
+		while (1)
+		{
+			tStringItem* file = nullptr;
+			bool walkDone = false;
+			{
+				std::lock_guard<std::mutex> lock(state->Mutex);
+				file = state->Pending.IsEmpty() ? nullptr : state->Pending.Remove();
+				walkDone = state->WalkDone;
+			}
+
+			if (!file)
+			{
+				if (walkDone)
+					break;
+				tSystem::tSleep(10);
+				continue;
+			}
+
+			Image image(*file);
+			switch (image.WarmThumbnail(level))
+			{
+				case Image::WarmResult::Generated:
+					state->NumGenerated++;
+					state->NumBytesRead += image.FileInfoValid ? int64(image.FileSizeB) : 0;
+					break;
+
+				case Image::WarmResult::Cached:
+					state->NumCached++;
+					break;
+
+				case Image::WarmResult::Skipped:
+					state->NumSkipped++;
+					break;
+
+				case Image::WarmResult::Failed:
+				{
+					state->NumFailed++;
+					std::lock_guard<std::mutex> lock(state->Mutex);
+					state->Failed.Append(file);
+					file = nullptr;
+					break;
+				}
+			}
+			delete file;
+		}
+		state->NumWorkers--;
+	}
+
+
+	void PrintProgress(const WarmState& state, int numFound, double startTime)
+	{
+		int numGenerated = state.NumGenerated;
+		int numDone = numGenerated + state.NumCached + state.NumSkipped + state.NumFailed;
+		double seconds = tMax(tSystem::tGetTime() - startTime, 0.001);
+		double mb = double(state.NumBytesRead) / (1024.0*1024.0);
+		tPrintf
+		(
+			"Warmed %d of %d found. %d generated (%.1f/s, %.1f MB/s), %d already cached, %d skipped, %d failed.\n",
+			numDone, numFound, numGenerated, double(numGenerated)/seconds, mb/seconds,
+			int(state.NumCached), int(state.NumSkipped), int(state.NumFailed)
+		);
+	}
+}
+
+
+int WarmThumbnailCache(const tString& rootDir, int maxDepth, int level, const ExtensionSet* extensions)
+{
+	WarmState state;
+	double startTime = tSystem::tGetTime();
+
+	// The tree scanner only reports subfolders so the root is scanned here. Workers start on those files while the
+	// rest of the tree is still being walked.
+	DirScan scan;
+	if (!scan.Scan(rootDir, extensions))
+	{
+		tPrintf("Error: Unable to open folder %s\n", rootDir.Chars());
+		return 1;
+	}
+	scan.SortFiles();
+	for (int f = 0; f < scan.GetNumFiles(); f++)
+		state.Pending.Append(new tStringItem(scan.GetFilePath(f)));
+	int numFound = scan.GetNumFiles();
+
+	TreeScanner walker;
+	walker.Start(scan.GetDir(), maxDepth, extensions);
+
+	int numWorkers = tMax(tSystem::tGetNumCores(), 1);
+	tPrintf("Warming thumbnail cache for %s using %d threads.\n", scan.GetDir().Chars(), numWorkers);
+	std::thread* workers = new std::thread[numWorkers];
+	state.NumWorkers = numWorkers;
+	for (int w = 0; w < numWorkers; w++)
+		workers[w] = std::thread(Work, &state, level);
+
+	// Once the walk is done the workers exit by themselves when the queue runs dry.
+	double lastReport = startTime;
+	bool walkDone = false;
+	while (!walkDone || (state.NumWorkers > 0))
+	{
+		if (!walkDone)
+		{
+			tList<tStringItem> found;
+			walkDone = walker.TakeFiles(found, 4096);
+			numFound += found.Count();
+			std::lock_guard<std::mutex> lock(state.Mutex);
+			while (!found.IsEmpty())
+				state.Pending.Append(found.Remove());
+			state.WalkDone = walkDone;
+		}
+
+		if (tSystem::tGetTime() - lastReport >= 1.0)
+		{
+			PrintProgress(state, numFound, startTime);
+			lastReport = tSystem::tGetTime();
+		}
+		tSystem::tSleep(50);
+	}
+
+	for (int w = 0; w < numWorkers; w++)
+		workers[w].join();
+	delete[] workers;
+
+	PrintProgress(state, numFound, startTime);
+	for (tStringItem* file = state.Failed.First(); file; file = file->Next())
+		tPrintf("Failed: %s\n", file->Chars());
+	if (state.NumSkipped > 0)
+		tPrintf("Dds files were skipped as they need a GL context to decode.\n");
+	tPrintf("Done in %.1f seconds.\n", tSystem::tGetTime() - startTime);
+
+	return state.NumFailed;
+}
@@ -0,0 +1,25 @@
+// CacheWarmer.h
+//
+// Fills the thumbnail cache for a whole folder tree without opening a window. Meant to be run when new images are
+// ingested so the content view is already fast the first time anyone browses them.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tString.h>
+class ExtensionSet;
+
+
+// Writes the thumbnail levels up to level for every image in rootDir and its subfolders down to maxDepth. Images that
+// already have a cache file under the usual key are skipped, so running it again only does the new or changed files.
+// The tree is walked while the thumbnails are generated, using one worker per core. Progress, throughput and the files
+// that failed are printed. Blocks until done and returns the number of failures.
+int WarmThumbnailCache(const tString& rootDir, int maxDepth, int level, const ExtensionSet*);
@@ -122,6 +122,20 @@ void Viewer::DoContactSheetModalDialog(bool justOpened)
 		finalWidth = contactWidth;
 		finalHeight = contactHeight;
 	}
+
+	// Every frame gets loaded. The probed headers say roughly what that costs before committing to it.
+	int64 forecastBytes = 0;
+	int numUnknown = 0;
+	for (Image* img = Images.First(); img; img = img->Next())
+	{
+		if (img->IsLoaded())
+			continue;
+		if (img->Header.IsValid())
+			forecastBytes += img->Header.GetForecastMemSizeBytes();
+		else
+			numUnknown++;
+	}
+	ImGui::Text("Loading frames needs about %.0f MB%s", float(forecastBytes) / (1024.0f*1024.0f), numUnknown ? " plus unprobed files" : "");
 	ImGui::Separator();
 
 	// Matches tImage::tPicture::tFilter.
@@ -292,7 +306,6 @@ void Viewer::SaveContactSheetTo
 	// and set the current image to the generated one.
 	if (ImagesDir.IsEqualCI( tGetDir(outFile) ))
 	{
-		Images.Clear();
 		PopulateImages();
 		SetCurrentImage(outFile);
 	}
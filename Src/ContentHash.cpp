@@ -0,0 +1,147 @@
+// ContentHash.cpp
+//
+// A fast 64 bit hash of a file's bytes so identical files can share cached data wherever they live on disk.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <cstdio>
+#include <cstring>
+#include "ContentHash.h"
+
+
+const int ContentHash::ReadBlockSize = 256*1024;
+
+
+namespace
+{
+	const uint64 Prime1 = 0x9E3779B185EBCA87ull;
+	const uint64 Prime2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64 Prime3 = 0x165667B19E3779F9ull;
+	const uint64 Prime4 = 0x85EBCA77C2B2AE63ull;
+	const uint64 Prime5 = 0x27D4EB2F165667C5ull;
+	const int StripeSize = 32;
+
+	inline uint64 RotL(uint64 v, int r)																					{ return (v << r) | (v >> (64 - r)); }
+	inline uint64 Read64(const uint8* p)																				{ uint64 v; tMemcpy(&v, p, 8); return v; }
+	inline uint32 Read32(const uint8* p)																				{ uint32 v; tMemcpy(&v, p, 4); return v; }
+	inline uint64 Round(uint64 acc, uint64 input)																		{ return RotL(acc + input*Prime2, 31) * Prime1; }
+	inline uint64 Merge(uint64 acc, uint64 v)																			{ return (acc ^ Round(0, v)) * Prime1 + Prime4; }
+
+	// Holds the four lanes between calls so a file can be fed through in blocks. Only the final call may pass a
+	// length that isn't a multiple of StripeSize.
+	struct Hasher
+	{
+		Hasher(uint64 seed)																								: Seed(seed) { V[0] = seed + Prime1 + Prime2; V[1] = seed + Prime2; V[2] = seed; V[3] = seed - Prime1; }
+		void Stripes(const uint8* data, int numBytes);
+		uint64 Finish(const uint8* tail, int numTail);
+
+		uint64 Seed;
+		uint64 V[4];
+		uint64 TotalBytes = 0;
+	};
+}
+
+
+void Hasher::Stripes(const uint8* data, int numBytes)
+{
+	tAssert((numBytes % StripeSize) == 0);
+	const uint8* end = data + numBytes;
+	for (; data < end; data += StripeSize)
+	{
+		V[0] = Round(V[0], Read64(data));
+		V[1] = Round(V[1], Read64(data+8));
+		V[2] = Round(V[2], Read64(data+16));
+		V[3] = Round(V[3], Read64(data+24));
+	}
+	TotalBytes += numBytes;
+}
+
+
+uint64 Hasher::Finish(const uint8* tail, int numTail)
+{
+	tAssert(numTail < StripeSize);
+	uint64 h = 0;
+	if (TotalBytes >= StripeSize)
+	{
+		h = RotL(V[0], 1) + RotL(V[1], 7) + RotL(V[2], 12) + RotL(V[3], 18);
+		for (int v = 0; v < 4; v++)
+			h = Merge(h, V[v]);
+	}
+	else
+	{
+		h = Seed + Prime5;
+	}
+	h += TotalBytes + numTail;
+
+	const uint8* end = tail + numTail;
+	for (; tail + 8 <= end; tail += 8)
+		h = RotL(h ^ Round(0, Read64(tail)), 27) * Prime1 + Prime4;
+	if (tail + 4 <= end)
+	{
+		h = RotL(h ^ (uint64(Read32(tail)) * Prime1), 23) * Prime2 + Prime3;
+		tail += 4;
+	}
+	for (; tail < end; tail++)
+		h = RotL(h ^ (uint64(*tail) * Prime5), 11) * Prime1;
+
+	h ^= h >> 33;
+	h *= Prime2;
+	h ^= h >> 29;
+	h *= Prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+
+uint64 ContentHash::HashData(const uint8* data, int numBytes, uint64 seed)
+{
+	Hasher hasher(seed);
+	int numStriped = numBytes - (numBytes % StripeSize);
+	hasher.Stripes(data, numStriped);
+	return hasher.Finish(data + numStriped, numBytes - numStriped);
+}
+
+
+bool ContentHash::HashFile(uint64& hash, const tString& filename)
+{
+	FILE* file = fopen(filename.Chars(), "rb");
+	if (!file)
+		return false;
+
+	// Whole stripes are hashed as they arrive. Any partial stripe is carried to the front of the buffer for the next
+	// read, so short reads are handled too.
+	Hasher hasher(0);
+	uint8* buffer = new uint8[ReadBlockSize];
+	int numCarried = 0;
+	bool ok = true;
+	while (1)
+	{
+		int numRead = int(fread(buffer + numCarried, 1, ReadBlockSize - numCarried, file));
+		if (numRead <= 0)
+		{
+			ok = !ferror(file);
+			break;
+		}
+
+		int numAvail = numCarried + numRead;
+		int numStriped = numAvail - (numAvail % StripeSize);
+		hasher.Stripes(buffer, numStriped);
+		numCarried = numAvail - numStriped;
+		if (numCarried > 0)
+			memmove(buffer, buffer + numStriped, numCarried);
+	}
+	fclose(file);
+
+	if (ok)
+		hash = hasher.Finish(buffer, numCarried);
+	delete[] buffer;
+	return ok;
+}
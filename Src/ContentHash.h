@@ -0,0 +1,29 @@
+// ContentHash.h
+//
+// A fast 64 bit hash of a file's bytes so identical files can share cached data wherever they live on disk.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tString.h>
+
+
+namespace ContentHash
+{
+	// XXH64 of the whole file, read in large blocks. It runs many times faster than the disk, so the cost is the read.
+	// Returns false if the file can't be read.
+	bool HashFile(uint64& hash, const tString& filename);
+
+	// XXH64 of a block of memory. For streaming use HashFile.
+	uint64 HashData(const uint8* data, int numBytes, uint64 seed = 0);
+
+	const extern int ReadBlockSize;		// = 256*1024;
+}
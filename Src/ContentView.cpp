@@ -12,15 +12,25 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <vector>
 #include <System/tTime.h>
 #include <Math/tVector2.h>
 #include "imgui.h"
 #include "ContentView.h"
 #include "TacentView.h"
 #include "Image.h"
+#include "IconAtlas.h"
+#include "Profiler.h"
 using namespace tMath;
 
 
+namespace Viewer
+{
+	std::vector<Image*> ContentImages;
+	uint32 ContentImagesVersion					= 0xFFFFFFFF;
+}
+
+
 void Viewer::ShowContentViewDialog(bool* popen)
 {
 	ImGuiWindowFlags windowFlags = ImGuiWindowFlags_NoScrollbar;
@@ -35,6 +45,16 @@ void Viewer::ShowContentViewDialog(bool* popen)
 		return;
 	}
 
+	// Walking the image list to the first visible item would touch every image above it, so we keep an array that is
+	// only rebuilt when the list changes.
+	if (ContentImagesVersion != ImagesVersion)
+	{
+		ContentImages.clear();
+		for (Image* i = Images.First(); i; i = i->Next())
+			ContentImages.push_back(i);
+		ContentImagesVersion = ImagesVersion;
+	}
+
 	ImGuiWindowFlags thumbWindowFlags = 0;
 	ImGui::BeginChild("Thumbnails", tVector2(ImGui::GetWindowContentRegionWidth(), ImGui::GetWindowHeight()-61.0f), false, thumbWindowFlags);
 	
@@ -47,65 +67,123 @@ void Viewer::ShowContentViewDialog(bool* popen)
 	float extra = ImGui::GetWindowContentRegionMax().x - (float(numPerRow) * (Config.ThumbnailWidth + minSpacing));
 	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, tVector2(minSpacing + extra/float(numPerRow), minSpacing));
 	tVector2 thumbButtonSize(Config.ThumbnailWidth, Config.ThumbnailWidth*9.0f/16.0f); // 64 36, 32 18,
-	int thumbNum = 0;
-	for (Image* i = Images.First(); i; i = i->Next(), thumbNum++)
+
+	// Only the smallest thumbnail size that covers the displayed size in real pixels is read and uploaded.
+	float pixelWidth = Config.ThumbnailWidth * ImGui::GetIO().DisplayFramebufferScale.x;
+	int thumbLevel = Image::GetThumbLevel(pixelWidth, Config.ThumbnailHiDPI);
+	tVector2 thumbItemSize = thumbButtonSize + tVector2(0.0f, 32.0f);
+
+	// The thumbnails are drawn straight into the window draw list rather than in a child window each. Thumbnails go in
+	// channel 0 and text in channel 1. Since the thumbnails share a few atlas pages, ImGui can merge them into a draw
+	// call per page instead of interleaving them with the font texture.
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->ChannelsSplit(2);
+	Image::ThumbAtlas.NewFrame();
+
+	// Only the rows in view, plus a few either side, are touched. The rest of the grid is a single dummy item that gives
+	// the child window its scroll range, so an idle frame costs the same for 50 images or 50,000.
+	const int prefetchRows = 2;
+	int numImages = int(ContentImages.size());
+	int numRows = (numImages + numPerRow - 1) / numPerRow;
+	float spacingX = minSpacing + extra/float(numPerRow);
+	float rowHeight = thumbItemSize.y + minSpacing;
+	tVector2 gridOrigin = ImGui::GetCursorPos();
+	gridOrigin.x += 0.5f*extra/float(numPerRow);
+	float scrollY = ImGui::GetScrollY();
+	int firstVisibleRow = tClamp(int((scrollY - gridOrigin.y) / rowHeight), 0, numRows);
+	int endVisibleRow = tClamp(int((scrollY - gridOrigin.y + ImGui::GetWindowHeight()) / rowHeight) + 1, 0, numRows);
+	int firstNearRow = tClampMin(firstVisibleRow - prefetchRows, 0);
+	int endNearRow = tClampMax(endVisibleRow + prefetchRows, numRows);
+
+	ImU32 tintColour = ImGui::GetColorU32(ColourEnabledTint);
+	ImU32 textColour = ImGui::GetColorU32(ImGuiCol_Text);
+	ImU32 currColour = ImGui::GetColorU32(ImGuiCol_Separator);
+	int numPending = 0;
+	for (int thumbNum = firstVisibleRow*numPerRow; thumbNum < tMin(endVisibleRow*numPerRow, numImages); thumbNum++)
 	{
-		tVector2 cursor = ImGui::GetCursorPos();
-		if ((thumbNum % numPerRow) == 0)
-			ImGui::SetCursorPos(tVector2(0.5f*extra/float(numPerRow), cursor.y));
+		Image* i = ContentImages[thumbNum];
+		int row = thumbNum / numPerRow;
+		int col = thumbNum % numPerRow;
+		ImGui::SetCursorPos(gridOrigin + tVector2(float(col)*(thumbItemSize.x + spacingX), float(row)*rowHeight));
 
 		ImGui::PushID(thumbNum);
-		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, tVector2::zero);
 		bool isCurr = (i == CurrImage);
+		tVector2 itemMin = ImGui::GetCursorScreenPos();
+		// Next and previous are where the viewer goes from here, so their decodes are worth keeping.
+		bool likelyNext = CurrImage && ((i == CurrImage->Next()) || (i == CurrImage->Prev()));
+		i->RequestThumbnail(thumbLevel, likelyNext);
+		tVector2 uv0, uv1;
+		uint64 thumbnailTexID = i->BindThumbnail(uv0, uv1);
+		if (!thumbnailTexID)
+		{
+			numPending++;
+			thumbnailTexID = DefaultThumbnailIcon.Bind();
+			uv0 = DefaultThumbnailIcon.GetUV0();
+			uv1 = DefaultThumbnailIcon.GetUV1();
+		}
 
-		// Unlike other widgets, BeginChild ALWAYS needs a corresponding EndChild, even if it's invisible.
-		bool visible = ImGui::BeginChild("ThumbItem", thumbButtonSize+tVector2(0.0, 32.0f), false, ImGuiWindowFlags_NoDecoration);
-		if (visible)
+		if (ImGui::InvisibleButton("ThumbItem", thumbItemSize))
 		{
-			i->RequestThumbnail();
-			uint64 thumbnailTexID = i->BindThumbnail();
-			if (!thumbnailTexID)
-				thumbnailTexID = DefaultThumbnailImage.Bind();
-			if
-			(
-				thumbnailTexID &&
-				ImGui::ImageButton(ImTextureID(thumbnailTexID), thumbButtonSize, tVector2(0,1), tVector2(1,0), 0,
-				ColourBG, ColourEnabledTint)
-			)
-			{
-				CurrImage = i;
-				LoadCurrImage();
-			}
-
-			tString filename = tSystem::tGetFileName(i->Filename);
-			ImGui::Text(filename.Chars());
-
-			tString ttStr;
-			tsPrintf(ttStr, "%s\n%s\n%'d Bytes", 
+			CurrImage = i;
+			LoadCurrImage();
+		}
+
+		tString filename = tSystem::tGetFileName(i->Filename);
+		// The file info may still be on its way from the background stat.
+		tString ttStr = filename;
+		if (i->FileInfoValid)
+			tsPrintf(ttStr, "%s\n%s\n%'d Bytes",
 				filename.Chars(),
 				tSystem::tConvertTimeToString(tSystem::tConvertTimeToLocal(i->FileModTime)).Chars(), i->FileSizeB);
-			ShowToolTip(ttStr.Chars());
 
-			// We use a separator to indicate the current item.
-			if (isCurr)
-				ImGui::Separator(2.0f);
+		// The probed header gives the size and what decoding will cost without loading anything.
+		if (i->Header.IsValid())
+		{
+			tString headerStr;
+			tsPrintf(headerStr, "\n%dx%d %s\n%.1f MB Decoded",
+				i->Header.Width, i->Header.Height, tImage::tGetPixelFormatName(i->Header.PixelFormat),
+				float(i->Header.GetForecastMemSizeBytes()) / (1024.0f*1024.0f));
+			ttStr += headerStr;
 		}
-		else
+		ShowToolTip(ttStr.Chars());
+
+		if (thumbnailTexID)
 		{
-			// We need to keep calling bind even if the image is not visible. It frees up the worker threads.
-			if (i->IsThumbnailWorkerActive())
-				i->BindThumbnail();
-			else
-				i->UnrequestThumbnail();
+			drawList->ChannelsSetCurrent(0);
+			drawList->AddImage(ImTextureID(thumbnailTexID), itemMin, itemMin + thumbButtonSize, uv0, uv1, tintColour);
 		}
-		ImGui::EndChild();
-		ImGui::PopStyleVar();
 
-		if ((thumbNum+1) % numPerRow)
-			ImGui::SameLine();
+		// The filename is clipped to the item width.
+		drawList->ChannelsSetCurrent(1);
+		tVector2 textPos = itemMin + tVector2(0.0f, thumbButtonSize.y + style.ItemInnerSpacing.y);
+		ImVec4 clipRect(itemMin.x, itemMin.y, itemMin.x + thumbItemSize.x, itemMin.y + thumbItemSize.y);
+		drawList->AddText(ImGui::GetFont(), ImGui::GetFontSize(), textPos, textColour, filename.Chars(), nullptr, 0.0f, &clipRect);
+
+		// We use a line under the filename to indicate the current item.
+		if (isCurr)
+		{
+			float lineY = textPos.y + ImGui::GetFontSize() + style.ItemInnerSpacing.y;
+			drawList->AddRectFilled(tVector2(itemMin.x, lineY), tVector2(itemMin.x + thumbItemSize.x, lineY + 2.0f), currColour);
+		}
 
 		ImGui::PopID();
 	}
+
+	// The rows just out of view are requested after the visible ones so they only get threads that are left over.
+	// That way scrolling a little shows thumbnails that are already done.
+	int nearRows[2][2] = { { endVisibleRow, endNearRow }, { firstNearRow, firstVisibleRow } };
+	for (int n = 0; n < 2; n++)
+	{
+		for (int thumbNum = nearRows[n][0]*numPerRow; thumbNum < tMin(nearRows[n][1]*numPerRow, numImages); thumbNum++)
+			ContentImages[thumbNum]->RequestThumbnail(thumbLevel);
+	}
+
+	// Finished workers of images that are no longer near the view are joined by the viewer every frame.
+	ImGui::SetCursorPos(gridOrigin);
+	ImGui::Dummy(tVector2(1.0f, tClampMin(float(numRows)*rowHeight - minSpacing, 0.0f)));
+
+	drawList->ChannelsMerge();
+	Profiler::Record(Profiler::Metric::ThumbQueue, float(numPending));
 	ImGui::PopStyleVar();
 	ImGui::EndChild();
 
@@ -119,13 +197,33 @@ void Viewer::ShowContentViewDialog(bool* popen)
 	ImGui::PopItemWidth();
 
 	ImGui::PushItemWidth(100);
-	const char* sortItems[] = { "Alphabetical", "Date", "Size", "Type" };
+	const char* sortItems[] = { "Alphabetical", "Date", "Size", "Type", "Dimensions", "Format", "Natural", "Captured" };
 	if (ImGui::Combo("Sort", &Config.SortKey, sortItems, tNumElements(sortItems)))
 		SortImages(Settings::SortKeyEnum(Config.SortKey), Config.SortAscending);
 	ImGui::SameLine();
 	if (ImGui::Checkbox("Ascending", &Config.SortAscending))
 		SortImages(Settings::SortKeyEnum(Config.SortKey), Config.SortAscending);
 
+	// Changing the recursive options repopulates. Top level images and their thumbnails are kept.
+	ImGui::SameLine();
+	bool repopulate = ImGui::Checkbox("Recursive", &Config.RecursiveFolders);
+	ShowToolTip("Include images in subfolders. Subfolders are scanned in the background.");
+	if (Config.RecursiveFolders)
+	{
+		ImGui::SameLine();
+		ImGui::PushItemWidth(60);
+		ImGui::SliderInt("Depth", &Config.RecursiveMaxDepth, 1, 64);
+		if (ImGui::IsItemDeactivatedAfterEdit())
+			repopulate = true;
+		ImGui::PopItemWidth();
+	}
+	if (repopulate)
+	{
+		tString currFile = CurrImage ? CurrImage->Filename : tString();
+		PopulateImages();
+		SetCurrentImage(currFile);
+	}
+
 	ImGui::PopItemWidth();
 	ImGui::EndChild();
 	ImGui::End();
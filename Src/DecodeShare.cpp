@@ -0,0 +1,220 @@
+// DecodeShare.cpp
+//
+// Lets the thumbnail workers and the main image share decoded pictures so the same file is never decoded twice at once
+// and a worker's decode can be picked up by the viewer instead of being repeated.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <mutex>
+#include <new>
+#include <memory>
+#include <condition_variable>
+#include <unordered_map>
+#include "DecodeShare.h"
+using namespace tImage;
+
+
+namespace
+{
+	// An entry is in the map while it's being decoded or while it's kept. Waiters hold their own reference so they
+	// still get the result if the entry leaves the map as soon as the decode is done.
+	struct Entry
+	{
+		bool Decoding						= true;
+		bool Failed							= false;
+		int NumWaiters						= 0;
+		std::shared_ptr<tPicture> Picture;
+		uint64 LastUsed						= 0;
+	};
+
+	std::mutex Mutex;
+	std::condition_variable DecodeDone;
+	std::unordered_map<uint64, std::shared_ptr<Entry>> Entries;
+	int64 KeptBytes							= 0;
+	int64 BudgetBytes						= 0;
+	uint64 UseCount							= 0;
+
+	int64 GetNumBytes(const tPicture& picture)																			{ return int64(picture.GetNumPixels()) * sizeof(tPixel); }
+
+	// Set only copies the pixels. The rest of what a load fills in comes along too.
+	void Copy(tPicture& dest, const tPicture& src)																		{ dest.Set(src); dest.SrcPixelFormat = src.SrcPixelFormat; dest.Duration = src.Duration; }
+
+	// Must be called with the lock held. Only kept entries are dropped, never one still being decoded.
+	void Drop(uint64 key)
+	{
+		auto found = Entries.find(key);
+		if ((found == Entries.end()) || found->second->Decoding)
+			return;
+
+		if (found->second->Picture)
+			KeptBytes -= GetNumBytes(*found->second->Picture);
+		Entries.erase(found);
+	}
+
+
+	// Must be called with the lock held. There are only ever a handful of kept pictures so a linear search for the
+	// oldest is fine.
+	void Trim()
+	{
+		while (KeptBytes > BudgetBytes)
+		{
+			uint64 oldestKey = 0;
+			uint64 oldestUse = 0;
+			bool found = false;
+			for (const auto& keyEntry : Entries)
+			{
+				const Entry& entry = *keyEntry.second;
+				if (entry.Decoding || !entry.Picture)
+					continue;
+				if (!found || (entry.LastUsed < oldestUse))
+				{
+					oldestKey = keyEntry.first;
+					oldestUse = entry.LastUsed;
+					found = true;
+				}
+			}
+			if (!found)
+				break;
+			Drop(oldestKey);
+		}
+	}
+
+
+	// Publishes the result of a decode and wakes any waiters. A copy is only made if someone is waiting or it's being
+	// kept, and it's made without holding the lock so other workers aren't held up by it. Returns ok.
+	bool Finish(uint64 key, std::shared_ptr<Entry> entry, const tPicture& picture, bool ok, bool keep)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		bool fits = keep && (GetNumBytes(picture) <= BudgetBytes);
+		if (ok && ((entry->NumWaiters > 0) || fits))
+		{
+			// Anyone arriving while the copy is made is still waiting on Decoding, so they get it too.
+			// If there's no memory for the copy the waiters simply decode for themselves.
+			lock.unlock();
+			std::shared_ptr<tPicture> shared;
+			try
+			{
+				shared = std::make_shared<tPicture>();
+				Copy(*shared, picture);
+			}
+			catch (const std::bad_alloc&)
+			{
+				shared.reset();
+			}
+			lock.lock();
+			entry->Picture = shared;
+			entry->LastUsed = ++UseCount;
+		}
+		entry->Decoding = false;
+		entry->Failed = !ok;
+
+		// Waiters hold the entry themselves so it can leave the map right away if it isn't being kept.
+		auto found = Entries.find(key);
+		bool ours = (found != Entries.end()) && (found->second == entry);
+		if (ours && entry->Picture && fits)
+		{
+			KeptBytes += GetNumBytes(*entry->Picture);
+			Trim();
+		}
+		else if (ours)
+		{
+			Entries.erase(found);
+		}
+		lock.unlock();
+		DecodeDone.notify_all();
+		return ok;
+	}
+}
+
+
+bool DecodeShare::Acquire(tPicture& picture, uint64 key, const std::function<bool(tPicture&)>& decode, bool keep)
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	auto found = Entries.find(key);
+	if (found != Entries.end())
+	{
+		std::shared_ptr<Entry> entry = found->second;
+		if (entry->Decoding)
+		{
+			entry->NumWaiters++;
+			DecodeDone.wait(lock, [&entry] { return !entry->Decoding; });
+			entry->NumWaiters--;
+		}
+
+		// A published picture is never changed so it's copied after the lock is released.
+		std::shared_ptr<tPicture> shared = entry->Picture;
+		if (entry->Failed)
+			return false;
+		if (!shared)
+		{
+			lock.unlock();
+			return decode(picture) && picture.IsValid();
+		}
+
+		entry->LastUsed = ++UseCount;
+		if (!keep)
+			Drop(key);
+		lock.unlock();
+
+		Copy(picture, *shared);
+		return true;
+	}
+
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	Entries[key] = entry;
+	lock.unlock();
+
+	// The decode goes straight into the caller's picture. A loader may throw, and waiters must still be woken.
+	bool ok = false;
+	try
+	{
+		ok = decode(picture) && picture.IsValid();
+	}
+	catch (...)
+	{
+		Finish(key, entry, picture, false, false);
+		throw;
+	}
+
+	return Finish(key, entry, picture, ok, keep);
+}
+
+
+void DecodeShare::SetBudget(int64 budgetBytes)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	BudgetBytes = budgetBytes;
+	Trim();
+}
+
+
+int64 DecodeShare::GetKeptBytes()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return KeptBytes;
+}
+
+
+void DecodeShare::Clear()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	for (auto entry = Entries.begin(); entry != Entries.end(); )
+	{
+		if (entry->second->Decoding)
+		{
+			entry++;
+			continue;
+		}
+		if (entry->second->Picture)
+			KeptBytes -= GetNumBytes(*entry->second->Picture);
+		entry = Entries.erase(entry);
+	}
+}
@@ -0,0 +1,37 @@
+// DecodeShare.h
+//
+// Lets the thumbnail workers and the main image share decoded pictures so the same file is never decoded twice at once
+// and a worker's decode can be picked up by the viewer instead of being repeated.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <functional>
+#include <Image/tPicture.h>
+
+
+// Pictures are identified by a key the caller makes from everything that affects the decoded pixels, such as the file
+// name, size, mod time and load parameters. All functions are thread safe.
+namespace DecodeShare
+{
+	// Fills picture with the decode of key. If another thread is already decoding the same key this waits for it and
+	// copies the result. If a kept picture exists it is copied. Otherwise decode is called, without holding any lock.
+	// When keep is true the result is kept for later calls as long as it fits the budget. When it's false any kept
+	// copy is let go, as the caller now has its own. Returns false if the decode failed. If decode throws, waiters are
+	// woken (and told it failed) before the exception carries on to the caller. Copies are made outside the lock.
+	bool Acquire(tImage::tPicture& picture, uint64 key, const std::function<bool(tImage::tPicture&)>& decode, bool keep);
+
+	// Kept pictures beyond budgetBytes are dropped, oldest first. The budget starts at zero, so nothing is kept until
+	// this is called.
+	void SetBudget(int64 budgetBytes);
+	int64 GetKeptBytes();
+	void Clear();
+}
@@ -21,6 +21,8 @@
 #include "Dialogs.h"
 #include "Settings.h"
 #include "Image.h"
+#include "IconAtlas.h"
+#include "Profiler.h"
 #include "TacentView.h"
 #include "Version.cmake.h"
 using namespace tMath;
@@ -102,6 +104,70 @@ void Viewer::ShowImageDetailsOverlay(bool* popen, float x, float y, float w, flo
 }
 
 
+void Viewer::ShowProfilerOverlay(bool* popen, float x, float y, float w, float h)
+{
+	// The profiler sits in the corner horizontally opposite the image details overlay so they never overlap.
+	const float margin = 6.0f;
+	int corner = Config.OverlayCorner ^ 1;
+
+	tVector2 windowPos = tVector2
+	(
+		x + ((corner & 1) ? w - margin : margin),
+		y + ((corner & 2) ? h - margin : margin)
+	);
+	tVector2 windowPivot = tVector2
+	(
+		(corner & 1) ? 1.0f : 0.0f,
+		(corner & 2) ? 1.0f : 0.0f
+	);
+	ImGui::SetNextWindowPos(windowPos, ImGuiCond_Always, windowPivot);
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	ImGuiWindowFlags flags =
+		ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
+		ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+		ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoScrollbar;
+
+	if (ImGui::Begin("Profiler", popen, flags))
+	{
+		ImGui::SetCursorPosX(ImGui::GetCursorPosX()+30);
+		ImGui::Text("Profiler                ");
+		ShowToolTip("Right-Click for Options");
+		ImGui::Separator();
+
+		float samples[Profiler::HistorySize];
+		for (int m = 0; m < int(Profiler::Metric::NumMetrics); m++)
+		{
+			Profiler::Metric metric = Profiler::Metric(m);
+			int numSamples = Profiler::GetHistory(metric, samples, Profiler::HistorySize);
+			Profiler::Stats stats = Profiler::GetStats(metric);
+			const char* units = Profiler::GetUnits(metric);
+
+			tString overlay;
+			tsPrintf(overlay, "p50 %.1f  p95 %.1f  p99 %.1f%s", stats.P50, stats.P95, stats.P99, units);
+			ImGui::Text("%s", Profiler::GetName(metric));
+			ImGui::PushID(m);
+			ImGui::PlotLines("", samples, numSamples, 0, overlay.Chars(), 0.0f, tMax(stats.Max, 1.0f), tVector2(240.0f, 36.0f));
+			ImGui::PopID();
+		}
+
+		if (ImGui::Button("Dump To Log"))
+			Profiler::Dump();
+		ImGui::SameLine();
+		if (ImGui::Button("Reset"))
+			Profiler::Reset();
+
+		if (ImGui::BeginPopupContextWindow())
+		{
+			if (ImGui::MenuItem("Dump To Log")) Profiler::Dump();
+			if (ImGui::MenuItem("Reset")) Profiler::Reset();
+			if (popen && ImGui::MenuItem("Close")) *popen = false;
+			ImGui::EndPopup();
+		}
+	}
+	ImGui::End();
+}
+
+
 void Viewer::ShowCheatSheetPopup(bool* popen)
 {
 	tVector2 windowPos = GetDialogOrigin(4);
@@ -123,6 +189,7 @@ void Viewer::ShowCheatSheetPopup(bool* popen)
 		ImGui::Text("Ctrl +");		ImGui::SameLine(); ImGui::SetCursorPosX(col); ImGui::Text("Zoom In");
 		ImGui::Text("Ctrl -");		ImGui::SameLine(); ImGui::SetCursorPosX(col); ImGui::Text("Zoom Out");
 		ImGui::Text("F1");			ImGui::SameLine(); ImGui::SetCursorPosX(col); ImGui::Text("Toggle Cheat Sheet");
+		ImGui::Text("F2");			ImGui::SameLine(); ImGui::SetCursorPosX(col); ImGui::Text("Toggle Profiler");
 		ImGui::Text("F5");			ImGui::SameLine(); ImGui::SetCursorPosX(col); ImGui::Text("Refresh/Reload Image");
 		ImGui::Text("F11");			ImGui::SameLine(); ImGui::SetCursorPosX(col); ImGui::Text("Toggle Fullscreen");
 		ImGui::Text("Alt-Enter");   ImGui::SameLine(); ImGui::SetCursorPosX(col); ImGui::Text("Toggle Fullscreen");
@@ -361,31 +428,31 @@ void Viewer::ShowPropertyEditorWindow(bool* popen)
 		ImGui::Separator();
 		ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 8);
 
-		uint64 loopImageID = CurrImage->PartPlayLooping ? PlayOnceImage.Bind() : PlayLoopImage.Bind();
-		if (ImGui::ImageButton(ImTextureID(loopImageID), tVector2(18, 18), tVector2(0, 1), tVector2(1, 0), 2, ColourBG, ColourEnabledTint))
+		const Icon& loopIcon = CurrImage->PartPlayLooping ? PlayOnceIcon : PlayLoopIcon;
+		if (IconButton(loopIcon, tVector2(18, 18), false, 2, ColourBG, ColourEnabledTint))
 			CurrImage->PartPlayLooping = !CurrImage->PartPlayLooping;
 		ImGui::SameLine();
 
 		bool prevEnabled = !CurrImage->PartPlaying && (CurrImage->PartNum > 0);
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(SkipBeginImage.Bind()), tVector2(18, 18), tVector2(0, 1), tVector2(1, 0), 2,
+			SkipBeginIcon, tVector2(18, 18), false, 2,
 			ColourBG, prevEnabled ? ColourEnabledTint : ColourDisabledTint) && prevEnabled
 		)	CurrImage->PartNum = 0;
 		ImGui::SameLine();
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(PrevImage.Bind()), tVector2(18, 18), tVector2(0, 1), tVector2(1, 0), 2,
+			PrevIcon, tVector2(18, 18), false, 2,
 			ColourBG, prevEnabled ? ColourEnabledTint : ColourDisabledTint) && prevEnabled
 		)	CurrImage->PartNum = tClampMin(CurrImage->PartNum-1, 0);
 		ImGui::SameLine();
 
 		bool playRevEnabled = !(CurrImage->PartPlaying && !CurrImage->PartPlayRev);
-		uint64 playRevImageID = !CurrImage->PartPlaying ? PlayRevImage.Bind() : StopRevImage.Bind();
-		if (ImGui::ImageButton
+		const Icon& playRevIcon = !CurrImage->PartPlaying ? PlayRevIcon : StopRevIcon;
+		if (IconButton
 		(
-			ImTextureID(playRevImageID), tVector2(18, 18), tVector2(0, 1), tVector2(1, 0), 2,
+			playRevIcon, tVector2(18, 18), false, 2,
 			ColourBG, playRevEnabled ? ColourEnabledTint : ColourDisabledTint) && playRevEnabled
 		)
 		{
@@ -395,10 +462,10 @@ void Viewer::ShowPropertyEditorWindow(bool* popen)
 		ImGui::SameLine();
 
 		bool playFwdEnabled = !(CurrImage->PartPlaying && CurrImage->PartPlayRev);
-		uint64 playImageID = !CurrImage->PartPlaying ? PlayImage.Bind() : StopImage.Bind();
-		if (ImGui::ImageButton
+		const Icon& playIcon = !CurrImage->PartPlaying ? PlayIcon : StopIcon;
+		if (IconButton
 		(
-			ImTextureID(playImageID), tVector2(18, 18), tVector2(0, 1), tVector2(1, 0), 2,
+			playIcon, tVector2(18, 18), false, 2,
 			ColourBG, playFwdEnabled ? ColourEnabledTint : ColourDisabledTint) && playFwdEnabled
 		)
 		{
@@ -408,16 +475,16 @@ void Viewer::ShowPropertyEditorWindow(bool* popen)
 		ImGui::SameLine();
 
 		bool nextEnabled = !CurrImage->PartPlaying && (CurrImage->PartNum < (numParts-1));
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(NextImage.Bind()), tVector2(18, 18), tVector2(0, 1), tVector2(1, 0), 2,
+			NextIcon, tVector2(18, 18), false, 2,
 			ColourBG, nextEnabled ? ColourEnabledTint : ColourDisabledTint) && nextEnabled
 		)	CurrImage->PartNum = tClampMax(CurrImage->PartNum+1, numParts-1);
 		ImGui::SameLine();
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(SkipEndImage.Bind()), tVector2(18, 18), tVector2(0, 1), tVector2(1, 0), 2,
+			SkipEndIcon, tVector2(18, 18), false, 2,
 			ColourBG, nextEnabled ? ColourEnabledTint : ColourDisabledTint) && nextEnabled
 		)	CurrImage->PartNum = numParts-1;
 		ImGui::SameLine();
@@ -478,9 +545,14 @@ void Viewer::ShowPreferencesWindow(bool* popen)
 	ImGui::InputInt("Max Mem (MB)", &Config.MaxImageMemMB); ImGui::SameLine();
 	ShowHelpMark("Approx memory use limit of this app. Minimum 256 MB.");
 	tMath::tiClampMin(Config.MaxImageMemMB, 256);
-	ImGui::InputInt("Max Cache Files", &Config.MaxCacheFiles); ImGui::SameLine();
-	ShowHelpMark("Maximum number of cache files that may be created. Minimum 200.");
-	tMath::tiClampMin(Config.MaxCacheFiles, 200);
+	ImGui::InputInt("Max Cache (MB)", &Config.MaxCacheSizeMB); ImGui::SameLine();
+	ShowHelpMark("Thumbnail cache size limit. The least recently viewed thumbnails are removed first. Minimum 64 MB.");
+	tMath::tiClampMin(Config.MaxCacheSizeMB, 64);
+	ImGui::InputInt("Max Thumb Mem (MB)", &Config.MaxThumbnailMemMB); ImGui::SameLine();
+	ShowHelpMark("Memory for thumbnail pixels. The least recently drawn are dropped and reloaded from the cache if needed. Minimum 16 MB.");
+	tMath::tiClampMin(Config.MaxThumbnailMemMB, 16);
+	ImGui::Checkbox("Share Thumbnails", &Config.ThumbnailDedup); ImGui::SameLine();
+	ShowHelpMark("Identical files share one thumbnail wherever they are. Files are hashed when their thumbnail is missing.");
 	if (!DeleteAllCacheFilesOnExit)
 	{
 		if (ImGui::Button("Clear Cache"))
@@ -502,6 +574,8 @@ void Viewer::ShowPreferencesWindow(bool* popen)
 	ImGui::Checkbox("Confirm File Overwrites", &Config.ConfirmFileOverwrites);
 	ImGui::Checkbox("Auto Propery Window", &Config.AutoPropertyWindow);
 	ImGui::Checkbox("Auto Play Anims", &Config.AutoPlayAnimatedImages);
+	ImGui::Checkbox("HiDPI Thumbnails", &Config.ThumbnailHiDPI); ImGui::SameLine();
+	ShowHelpMark("Use 512 wide thumbnails when the display is scaled up and they'd be drawn over 256 pixels wide.");
 	
 	ImGui::Unindent();
 	ImGui::Separator();
@@ -674,7 +748,7 @@ void Viewer::NavLogBar::Draw()
 
 	if
 	(
-		ImGui::ImageButton(ImTextureID(UpFolderImage.Bind()), tVector2(18,18), tVector2(0,1), tVector2(1,0), 1,
+		IconButton(UpFolderIcon, tVector2(18,18), false, 1,
 		Viewer::ColourBG, tVector4(1.00f, 1.00f, 1.00f, 1.00f))
 	)
 	{
@@ -691,27 +765,26 @@ void Viewer::NavLogBar::Draw()
 	ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 3.0f);
 	ImGui::Text("%s", ImagesDir.Chars());
 
-	if (ImagesSubDirs.NumItems() > 0)
+	FolderTree::Node* root = ImagesFolders.GetRoot();
+	if (root && !root->Children.IsEmpty())
 	{
 		ImGui::SameLine();
 		ImGui::SetCursorPosY(ImGui::GetCursorPosY() - 3.0f);
+		FolderTree::Node* selected = nullptr;
 		if (ImGui::BeginCombo("##combo", nullptr, ImGuiComboFlags_PopupAlignLeft | ImGuiComboFlags_HeightLargest | ImGuiComboFlags_NoPreview))
 		{
-			for (tStringItem* subDir = ImagesSubDirs.First(); subDir; subDir = subDir->Next())
-			{
-				bool isSelected = false;
-				if (ImGui::Selectable(subDir->Chars(), isSelected))
-				{
-					// Selection made. This only runs once.
-					ImageFileParam.Param = ImagesDir + *subDir + "/" + "dummyfile.txt";
-					PopulateImages();
-					SetCurrentImage();
-					SetWindowTitle();
-					break;
-				}
-			}
+			DrawFolders(root, selected);
 			ImGui::EndCombo();
 		}
+
+		// Navigating rebuilds the tree so it must wait until we're done drawing it.
+		if (selected)
+		{
+			ImageFileParam.Param = selected->Path + "dummyfile.txt";
+			PopulateImages();
+			SetCurrentImage();
+			SetWindowTitle();
+		}
 	}
 
 	if (ShowLog)
@@ -719,6 +792,44 @@ void Viewer::NavLogBar::Draw()
 }
 
 
+void Viewer::NavLogBar::DrawFolders(FolderTree::Node* parent, FolderTree::Node*& selected)
+{
+	for (FolderTree::Node* node = parent->Children.First(); node; node = node->Next())
+	{
+		// Being visible is what gets a folder listed, so only the folders the user can see are ever enumerated.
+		ImagesFolders.Request(node);
+
+		tString label;
+		if (node->HasCounts)
+			tsPrintf(label, "%s   %d images  %.1f MB", node->Name.Chars(), node->NumImages, float(node->NumBytes)/(1024.0f*1024.0f));
+		else
+			label = node->Name;
+
+		ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow;
+		bool isLeaf = (node->State == FolderTree::Node::StateEnum::Listed) && node->Children.IsEmpty();
+		if (isLeaf)
+			flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+
+		// The counts change as listings arrive, so they can't be part of the ID or the node would lose its open state.
+		ImGui::PushID(node);
+		bool open = ImGui::TreeNodeEx("Folder", flags, "%s", label.Chars());
+		// A click on the arrow only opens the node. A click on the label goes to the folder.
+		bool onArrow = (ImGui::GetMousePos().x - ImGui::GetItemRectMin().x) < ImGui::GetTreeNodeToLabelSpacing();
+		if (ImGui::IsItemClicked() && !onArrow)
+			selected = node;
+		ImGui::PopID();
+
+		if (!open || isLeaf)
+			continue;
+
+		if (node->State != FolderTree::Node::StateEnum::Listed)
+			ImGui::TextDisabled("Listing...");
+		DrawFolders(node, selected);
+		ImGui::TreePop();
+	}
+}
+
+
 void Viewer::NavLogBar::DrawLog()
 {
 	if (ImGui::Button("Clear"))
@@ -13,11 +13,13 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #pragma once
+#include "FolderTree.h"
 
 
 namespace Viewer
 {
 	void ShowImageDetailsOverlay(bool* popen, float x, float y, float w, float h, int cursorX, int cursorY, float zoom);
+	void ShowProfilerOverlay(bool* popen, float x, float y, float w, float h);
 	void ShowCheatSheetPopup(bool* popen);
 	void ShowAboutPopup(bool* popen);
 	void ShowPreferencesWindow(bool* popen);
@@ -41,6 +43,9 @@ namespace Viewer
 		void ClearLog();
 		void DrawLog();
 
+		// Draws the children of the node, listing any that haven't been yet. Sets selected if one was clicked.
+		void DrawFolders(FolderTree::Node*, FolderTree::Node*& selected);
+
 		bool ShowLog = false;
 		ImGuiTextBuffer LogBuf;
 		ImGuiTextFilter LogFilter;
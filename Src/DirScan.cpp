@@ -0,0 +1,324 @@
+// DirScan.cpp
+//
+// Single pass directory enumeration. Files are filtered by extension and subdirectories are collected in the same
+// pass. All names are stored in one contiguous buffer.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#elif defined(PLATFORM_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <Foundation/tStandard.h>
+#include <Math/tFundamentals.h>
+#include "DirScan.h"
+
+
+static inline char ToLower(char c)
+{
+	return ((c >= 'A') && (c <= 'Z')) ? c - 'A' + 'a' : c;
+}
+
+
+ExtensionSet::ExtensionSet(const char** extensions, int numExtensions)
+{
+	tMemset(Table, 0xFF, sizeof(Table));
+	for (int e = 0; (e < numExtensions) && (NumExtensions < MaxExtensions); e++)
+	{
+		int len = tStrlen(extensions[e]);
+		if ((len == 0) || (len > MaxExtLength) || Contains(extensions[e], len))
+			continue;
+
+		char* dest = Extensions[NumExtensions];
+		for (int c = 0; c < len; c++)
+			dest[c] = ToLower(extensions[e][c]);
+		dest[len] = '\0';
+
+		int slot = Hash(dest, len) & (TableSize-1);
+		while (Table[slot] != -1)
+			slot = (slot + 1) & (TableSize-1);
+		Table[slot] = int8(NumExtensions++);
+	}
+}
+
+
+uint32 ExtensionSet::Hash(const char* lowerExt, int extLength)
+{
+	// FNV-1a. The extensions are tiny so anything more involved would be slower.
+	uint32 hash = 2166136261u;
+	for (int c = 0; c < extLength; c++)
+		hash = (hash ^ uint8(lowerExt[c])) * 16777619u;
+	return hash;
+}
+
+
+bool ExtensionSet::Contains(const char* ext, int extLength) const
+{
+	if ((extLength <= 0) || (extLength > MaxExtLength))
+		return false;
+
+	char lower[MaxExtLength+1];
+	for (int c = 0; c < extLength; c++)
+		lower[c] = ToLower(ext[c]);
+
+	// The table is never more than half full so the probe always reaches an empty slot.
+	for (int slot = Hash(lower, extLength) & (TableSize-1); Table[slot] != -1; slot = (slot + 1) & (TableSize-1))
+	{
+		const char* candidate = Extensions[Table[slot]];
+		int c = 0;
+		while ((c < extLength) && (candidate[c] == lower[c]))
+			c++;
+		if ((c == extLength) && (candidate[c] == '\0'))
+			return true;
+	}
+	return false;
+}
+
+
+bool ExtensionSet::ContainsFile(const char* filename, int filenameLength) const
+{
+	int dot = filenameLength - 1;
+	while ((dot >= 0) && (filename[dot] != '.') && (filename[dot] != '/'))
+		dot--;
+	if ((dot < 0) || (filename[dot] != '.'))
+		return false;
+
+	return Contains(filename + dot + 1, filenameLength - dot - 1);
+}
+
+
+void DirScan::Clear()
+{
+	delete[] Names;
+	delete[] Files;
+	delete[] SubDirs;
+	Names = nullptr;
+	Files = nullptr;
+	SubDirs = nullptr;
+	NamesSize = NamesCapacity = 0;
+	NumFiles = FilesCapacity = 0;
+	NumSubDirs = SubDirsCapacity = 0;
+	Dir.Clear();
+}
+
+
+int DirScan::AddName(const char* name, int nameLength)
+{
+	if (NamesSize + nameLength + 1 > NamesCapacity)
+	{
+		int newCapacity = tMath::tMax(NamesCapacity*2, NamesSize + nameLength + 1, 4096);
+		char* newNames = new char[newCapacity];
+		if (Names)
+			tMemcpy(newNames, Names, NamesSize);
+		delete[] Names;
+		Names = newNames;
+		NamesCapacity = newCapacity;
+	}
+
+	int offset = NamesSize;
+	tMemcpy(Names + offset, name, nameLength);
+	Names[offset + nameLength] = '\0';
+	NamesSize += nameLength + 1;
+	return offset;
+}
+
+
+void DirScan::AddOffset(int*& offsets, int& count, int& capacity, int offset)
+{
+	if (count >= capacity)
+	{
+		int newCapacity = tMath::tMax(capacity*2, 256);
+		int* newOffsets = new int[newCapacity];
+		if (offsets)
+			tMemcpy(newOffsets, offsets, count*sizeof(int));
+		delete[] offsets;
+		offsets = newOffsets;
+		capacity = newCapacity;
+	}
+	offsets[count++] = offset;
+}
+
+
+void DirScan::AddFile(const char* name, int nameLength, const ExtensionSet* extensions, bool hasInfo, std::time_t modTime, uint64 fileSize)
+{
+	if (extensions && !extensions->ContainsFile(name, nameLength))
+		return;
+
+	if (NumFiles >= FilesCapacity)
+	{
+		int newCapacity = tMath::tMax(FilesCapacity*2, 256);
+		FileEntry* newFiles = new FileEntry[newCapacity];
+		if (Files)
+			tMemcpy(newFiles, Files, NumFiles*sizeof(FileEntry));
+		delete[] Files;
+		Files = newFiles;
+		FilesCapacity = newCapacity;
+	}
+
+	FileEntry& entry = Files[NumFiles++];
+	entry.Name = AddName(name, nameLength);
+	entry.HasInfo = hasInfo;
+	entry.ModTime = modTime;
+	entry.FileSize = fileSize;
+}
+
+
+bool DirScan::GetFileInfo(int index, std::time_t& modTime, uint64& fileSize) const
+{
+	const FileEntry& entry = Files[index];
+	if (!entry.HasInfo)
+		return false;
+
+	modTime = entry.ModTime;
+	fileSize = entry.FileSize;
+	return true;
+}
+
+
+void DirScan::AddSubDir(const char* name, int nameLength)
+{
+	if ((name[0] == '.') && ((nameLength == 1) || ((nameLength == 2) && (name[1] == '.'))))
+		return;
+
+	AddOffset(SubDirs, NumSubDirs, SubDirsCapacity, AddName(name, nameLength));
+}
+
+
+int DirScan::CompareNames(const char* a, const char* b)
+{
+	int result = tStricmp(a, b);
+	return result ? result : tStrcmp(a, b);
+}
+
+
+void DirScan::SortFiles()
+{
+	const char* names = Names;
+	std::sort
+	(
+		Files, Files + NumFiles,
+		[names](const FileEntry& a, const FileEntry& b) { return CompareNames(names + a.Name, names + b.Name) < 0; }
+	);
+}
+
+
+#if defined(PLATFORM_LINUX)
+bool DirScan::Scan(const tString& dir, const ExtensionSet* extensions)
+{
+	Clear();
+	Dir = dir;
+	if (Dir.IsEmpty() || (Dir[Dir.Length()-1] != '/'))
+		Dir += "/";
+
+	int fd = open(Dir.Chars(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	// We go straight to getdents64 with a large buffer. Each call returns hundreds of entries along with their type,
+	// so nothing needs to be stat'd unless the filesystem doesn't fill in d_type.
+	struct LinuxDirent64
+	{
+		uint64 Inode;
+		int64 Offset;
+		uint16 RecordLength;
+		uint8 Type;
+		char Name[1];
+	};
+
+	const int bufferSize = 64*1024;
+	alignas(8) static thread_local char buffer[bufferSize];
+	while (true)
+	{
+		long numRead = syscall(SYS_getdents64, fd, buffer, bufferSize);
+		if (numRead == 0)
+			break;
+
+		// A partial listing would look like files were deleted, so a read error fails the whole scan.
+		if (numRead < 0)
+		{
+			close(fd);
+			Clear();
+			return false;
+		}
+
+		for (long offset = 0; offset < numRead; )
+		{
+			LinuxDirent64* entry = (LinuxDirent64*)(buffer + offset);
+			offset += entry->RecordLength;
+
+			const char* name = entry->Name;
+			int type = entry->Type;
+
+			// Symlinks are followed, the same as a stat-based scan would. Since we have the stat we keep the file info.
+			struct stat info;
+			bool hasInfo = false;
+			if ((type == DT_UNKNOWN) || (type == DT_LNK))
+			{
+				if (fstatat(fd, name, &info, 0) != 0)
+					continue;
+				hasInfo = true;
+				type = S_ISDIR(info.st_mode) ? DT_DIR : (S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN);
+			}
+
+			if (type == DT_REG)
+				AddFile(name, tStrlen(name), extensions, hasInfo, hasInfo ? std::time_t(info.st_mtime) : 0, hasInfo ? uint64(info.st_size) : 0);
+			else if (type == DT_DIR)
+				AddSubDir(name, tStrlen(name));
+		}
+	}
+
+	close(fd);
+	return true;
+}
+
+
+#elif defined(PLATFORM_WINDOWS)
+bool DirScan::Scan(const tString& dir, const ExtensionSet* extensions)
+{
+	Clear();
+	Dir = dir;
+	if (Dir.IsEmpty() || (Dir[Dir.Length()-1] != '/'))
+		Dir += "/";
+
+	// The basic info level skips the 8.3 short name lookup and the large fetch flag lets the filesystem return bigger
+	// batches. Both matter on network shares.
+	tString pattern = Dir + "*";
+	WIN32_FIND_DATAA data;
+	HANDLE handle = FindFirstFileExA(pattern.Chars(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	do
+	{
+		int nameLength = tStrlen(data.cFileName);
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			AddSubDir(data.cFileName, nameLength);
+		else
+		{
+			// File times count 100ns intervals since 1601.
+			uint64 fileTime = (uint64(data.ftLastWriteTime.dwHighDateTime) << 32) | uint64(data.ftLastWriteTime.dwLowDateTime);
+			std::time_t modTime = std::time_t((fileTime - 116444736000000000ull) / 10000000ull);
+			uint64 fileSize = (uint64(data.nFileSizeHigh) << 32) | uint64(data.nFileSizeLow);
+			AddFile(data.cFileName, nameLength, extensions, true, modTime, fileSize);
+		}
+	} while (FindNextFileA(handle, &data));
+
+	FindClose(handle);
+	return true;
+}
+#endif
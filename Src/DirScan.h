@@ -0,0 +1,103 @@
+// DirScan.h
+//
+// Single pass directory enumeration. Files are filtered by extension and subdirectories are collected in the same
+// pass. All names are stored in one contiguous buffer.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <ctime>
+#include <Foundation/tString.h>
+
+
+// A small open-addressing hash set of file extensions. Lookups are case-insensitive and do not allocate.
+class ExtensionSet
+{
+public:
+	// The extensions should not include the dot.
+	ExtensionSet(const char** extensions, int numExtensions);
+	bool Contains(const char* ext, int extLength) const;
+
+	// Checks the extension of a filename (or path). Files without an extension never match.
+	bool ContainsFile(const char* filename, int filenameLength) const;
+	bool ContainsFile(const tString& filename) const																	{ return ContainsFile(filename.Chars(), filename.Length()); }
+
+	const static int MaxExtensions		= 32;
+	const static int MaxExtLength		= 7;
+
+private:
+	static uint32 Hash(const char* lowerExt, int extLength);
+	const static int TableSize			= 64;	// Power of two and at least twice MaxExtensions.
+
+	char Extensions[MaxExtensions][MaxExtLength+1];
+	int NumExtensions					= 0;
+	int8 Table[TableSize];						// Index into Extensions or -1 if empty.
+};
+
+
+class DirScan
+{
+public:
+	DirScan()																											{ }
+	~DirScan()																											{ Clear(); }
+
+	// Enumerates dir exactly once. Regular files whose extension is in the set are kept, as is every subdirectory
+	// except . and .. so a null set keeps every file. Returns false if the directory could not be opened or read, in
+	// which case the scan is left empty.
+	bool Scan(const tString& dir, const ExtensionSet* extensions);
+	void Clear();
+
+	// Sorts the files by name using CompareNames. Since they all share a directory this is also a path sort.
+	void SortFiles();
+
+	// Case-insensitive, with names that differ only by case ordered case-sensitively so the order is total.
+	static int CompareNames(const char* a, const char* b);
+
+	const tString& GetDir() const																						{ return Dir; }		// Ends with a slash.
+	int GetNumFiles() const																								{ return NumFiles; }
+	const char* GetFileName(int index) const																			{ return Names + Files[index].Name; }
+	tString GetFilePath(int index) const																				{ return Dir + GetFileName(index); }
+	int GetNumSubDirs() const																							{ return NumSubDirs; }
+	const char* GetSubDirName(int index) const																			{ return Names + SubDirs[index]; }
+
+	// Some enumerations return the mod time and size along with the name. Windows always does. On Linux it only happens
+	// for entries that had to be stat'd anyway. Returns false if the info isn't available for this file.
+	bool GetFileInfo(int index, std::time_t& modTime, uint64& fileSize) const;
+
+private:
+	DirScan(const DirScan&) = delete;
+	DirScan& operator=(const DirScan&) = delete;
+
+	struct FileEntry
+	{
+		int Name;										// Offset into Names.
+		bool HasInfo;
+		std::time_t ModTime;
+		uint64 FileSize;
+	};
+
+	// The mod time and size are only used if hasInfo is true.
+	void AddFile(const char* name, int nameLength, const ExtensionSet*, bool hasInfo, std::time_t modTime, uint64 fileSize);
+	void AddSubDir(const char* name, int nameLength);
+	int AddName(const char* name, int nameLength);		// Returns the offset of the name in the Names buffer.
+	static void AddOffset(int*& offsets, int& count, int& capacity, int offset);
+
+	tString Dir;
+	char* Names							= nullptr;
+	int NamesSize						= 0;
+	int NamesCapacity					= 0;
+	FileEntry* Files					= nullptr;
+	int NumFiles						= 0;
+	int FilesCapacity					= 0;
+	int* SubDirs						= nullptr;		// Offsets into Names.
+	int NumSubDirs						= 0;
+	int SubDirsCapacity					= 0;
+};
@@ -0,0 +1,218 @@
+// DirWatcher.cpp
+//
+// Watches a single directory on a background thread and queues change events for the main thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifdef PLATFORM_LINUX
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#endif
+
+#include <System/tPrint.h>
+#include "DirWatcher.h"
+
+
+void DirWatcher::GetEvents(tList<Event>& events)
+{
+	std::lock_guard<std::mutex> lock(EventsMutex);
+	while (Event* event = Events.Remove())
+		events.Append(event);
+}
+
+
+#ifdef PLATFORM_LINUX
+bool DirWatcher::Start(const tString& dir)
+{
+	tString watchDir = dir;
+	if (watchDir.IsEmpty() || (watchDir[watchDir.Length()-1] != '/'))
+		watchDir += "/";
+
+	if (IsWatching() && Dir.IsEqual(watchDir))
+		return true;
+
+	Stop();
+	NotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (NotifyFD < 0)
+		return false;
+
+	// We don't want IN_MODIFY. It fires on every write while a file is being saved. IN_CLOSE_WRITE fires once at the end.
+	uint32 mask =
+		IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+		IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+	if (inotify_add_watch(NotifyFD, watchDir.Chars(), mask) < 0)
+	{
+		tPrintf("Warning: Unable to watch %s\n", watchDir.Chars());
+		close(NotifyFD);
+		NotifyFD = -1;
+		return false;
+	}
+
+	WakeFD = eventfd(0, EFD_CLOEXEC);
+	if (WakeFD < 0)
+	{
+		close(NotifyFD);
+		NotifyFD = -1;
+		return false;
+	}
+
+	Dir = watchDir;
+	Lost = false;
+	Thread = std::thread([this] { WatchLoop(); });
+	return true;
+}
+
+
+void DirWatcher::Stop()
+{
+	if (Thread.joinable())
+	{
+		uint64 one = 1;
+		ssize_t written = write(WakeFD, &one, sizeof(one));
+		(void)written;
+		Thread.join();
+	}
+
+	if (NotifyFD >= 0)
+		close(NotifyFD);
+	if (WakeFD >= 0)
+		close(WakeFD);
+	NotifyFD = -1;
+	WakeFD = -1;
+	Dir.Clear();
+
+	// Anything still queued refers to the old directory.
+	std::lock_guard<std::mutex> lock(EventsMutex);
+	Events.Clear();
+}
+
+
+void DirWatcher::WatchLoop()
+{
+	pollfd fds[2];
+	fds[0].fd = NotifyFD;	fds[0].events = POLLIN;
+	fds[1].fd = WakeFD;		fds[1].events = POLLIN;
+	while (true)
+	{
+		fds[0].revents = 0;
+		fds[1].revents = 0;
+		int result = poll(fds, 2, -1);
+		if ((result < 0) && (errno == EINTR))
+			continue;
+		if ((result < 0) || fds[1].revents)
+			break;
+
+		if (fds[0].revents & POLLIN)
+			ReadEvents();
+
+		// Nothing more will ever come once the directory itself is gone.
+		if (Lost)
+			break;
+	}
+}
+
+
+void DirWatcher::ReadEvents()
+{
+	alignas(inotify_event) char buffer[16*1024];
+	tList<Event> batch;
+	while (true)
+	{
+		ssize_t numRead = read(NotifyFD, buffer, sizeof(buffer));
+		if (numRead <= 0)
+			break;
+
+		for (ssize_t offset = 0; offset < numRead; )
+		{
+			const inotify_event* notify = (const inotify_event*)(buffer + offset);
+			offset += sizeof(inotify_event) + notify->len;
+
+			if (notify->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+			{
+				// An overflow only drops events. The others mean the watch itself is dead.
+				if (!(notify->mask & IN_Q_OVERFLOW))
+					Lost = true;
+				Event* event = new Event;
+				event->Type = EventType::Rescan;
+				batch.Append(event);
+				continue;
+			}
+
+			if (notify->len == 0)
+				continue;
+
+			// The second half of a rename turns the matching first half into a single Renamed event. Both halves
+			// almost always arrive in the same read. If not, the first half is left as a plain removal.
+			if (notify->mask & IN_MOVED_TO)
+			{
+				Event* from = batch.Last();
+				while (from && !((from->Type == EventType::Removed) && (from->Cookie == notify->cookie)))
+					from = from->Prev();
+
+				if (from)
+				{
+					from->Type = EventType::Renamed;
+					from->NewName = notify->name;
+					from->Cookie = 0;
+					continue;
+				}
+			}
+
+			Event* event = new Event;
+			event->IsDir = (notify->mask & IN_ISDIR) ? true : false;
+			event->Name = notify->name;
+			if (notify->mask & (IN_CREATE | IN_MOVED_TO))
+				event->Type = EventType::Added;
+			else if (notify->mask & (IN_DELETE | IN_MOVED_FROM))
+				event->Type = EventType::Removed;
+			else
+				event->Type = EventType::Modified;
+
+			if (notify->mask & IN_MOVED_FROM)
+				event->Cookie = notify->cookie;
+			batch.Append(event);
+		}
+	}
+
+	if (batch.IsEmpty())
+		return;
+
+	std::lock_guard<std::mutex> lock(EventsMutex);
+	while (Event* event = batch.Remove())
+		Events.Append(event);
+}
+
+
+#else
+bool DirWatcher::Start(const tString& dir)
+{
+	return false;
+}
+
+
+void DirWatcher::Stop()
+{
+}
+
+
+void DirWatcher::WatchLoop()
+{
+}
+
+
+void DirWatcher::ReadEvents()
+{
+}
+#endif
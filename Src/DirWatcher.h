@@ -0,0 +1,76 @@
+// DirWatcher.h
+//
+// Watches a single directory on a background thread and queues change events for the main thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+
+
+// Only the directory itself is watched, not its subdirectories. Currently only Linux (inotify) is supported. On other
+// platforms Start returns false and the caller should fall back to rescanning.
+class DirWatcher
+{
+public:
+	DirWatcher()																										{ }
+	~DirWatcher()																										{ Stop(); }
+
+	enum class EventType
+	{
+		Added,
+		Removed,
+		Renamed,							// Name is the old name and NewName the new one.
+		Modified,							// A file was closed after being written.
+		Rescan								// Events were dropped or the directory itself went away. Rescan everything.
+	};
+
+	struct Event : public tLink<Event>
+	{
+		EventType Type						= EventType::Rescan;
+		bool IsDir							= false;
+		tString Name;
+		tString NewName;
+		uint32 Cookie						= 0;	// Used to pair up the two halves of a rename.
+	};
+
+	// Starts watching dir. Calling it again with the same dir does nothing unless the watch was lost. Calling it with
+	// a different dir stops the current watch first. Returns false if the directory can't be watched.
+	bool Start(const tString& dir);
+	void Stop();
+
+	// False once the directory is deleted or moved, even though the Rescan event may not have been taken yet. The watch
+	// is dead by then, so callers fall back to rescanning and Start sets up a new one.
+	bool IsWatching() const																								{ return Thread.joinable() && !Lost; }
+	const tString& GetDir() const																						{ return Dir; }		// Ends with a slash.
+
+	// Moves all pending events into events, oldest first. Call from the main thread.
+	void GetEvents(tList<Event>& events);
+
+private:
+	DirWatcher(const DirWatcher&) = delete;
+	DirWatcher& operator=(const DirWatcher&) = delete;
+
+	void WatchLoop();
+	void ReadEvents();
+
+	tString Dir;
+	std::thread Thread;
+	std::mutex EventsMutex;
+	tList<Event> Events;
+	int NotifyFD							= -1;
+	int WakeFD								= -1;	// Written to by Stop to wake the watch thread.
+	std::atomic<bool> Lost					{ false };	// The directory itself went away. The watch thread has exited.
+};
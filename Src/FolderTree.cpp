@@ -0,0 +1,268 @@
+// FolderTree.cpp
+//
+// The subfolders of the images folder as a lazily expanded tree. Folders are listed on worker threads and each one
+// reports how many images it holds and their total size.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <algorithm>
+#include <Math/tFundamentals.h>
+#include <Math/tHash.h>
+#include "FolderTree.h"
+#include "DirScan.h"
+#include "StatFetcher.h"
+
+
+const int FolderTree::MaxWorkers = 2;
+const int FolderTree::MaxCacheEntries = 65536;
+
+
+void FolderTree::SetRoot(const tString& rootDir, const ExtensionSet* extensions)
+{
+	Extensions = extensions;
+	if (!Root || (Root->Path != rootDir))
+	{
+		Clear();
+		Root = new Node;
+		Root->Name = rootDir;
+		Root->Path = rootDir;
+		NodesByPath[tMath::tHashString64(rootDir.Chars())] = Root;
+	}
+	Refresh(Root);
+}
+
+
+void FolderTree::Clear()
+{
+	// Listings already underway still land in the cache when they come back, so they aren't wasted. Only abandoning
+	// the workers does that.
+	if (Root)
+		DeleteChildren(Root);
+	delete Root;
+	Root = nullptr;
+	NodesByPath.clear();
+}
+
+
+void FolderTree::DeleteChildren(Node* node)
+{
+	for (Node* child = node->Children.First(); child; child = child->Next())
+	{
+		DeleteChildren(child);
+		NodesByPath.erase(tMath::tHashString64(child->Path.Chars()));
+	}
+	node->Children.Clear();
+}
+
+
+void FolderTree::Cancel()
+{
+	if (!Queue.IsActive())
+		return;
+
+	Queue.Cancel();
+
+	// Nothing is being listed any more. Those nodes get listed again when next drawn.
+	for (auto& pathNode : NodesByPath)
+	{
+		if (pathNode.second->State == Node::StateEnum::Listing)
+			pathNode.second->State = Node::StateEnum::Unlisted;
+		pathNode.second->RelistPending = false;
+	}
+}
+
+
+FolderTree::Node* FolderTree::FindNode(const tString& path) const
+{
+	auto found = NodesByPath.find(tMath::tHashString64(path.Chars()));
+	if ((found == NodesByPath.end()) || (found->second->Path != path))
+		return nullptr;
+	return found->second;
+}
+
+
+void FolderTree::Request(Node* node)
+{
+	if (node->State == Node::StateEnum::Unlisted)
+		Refresh(node);
+}
+
+
+void FolderTree::Refresh(Node* node)
+{
+	if (node->State == Node::StateEnum::Listing)
+	{
+		node->RelistPending = true;
+		return;
+	}
+
+	// A cached listing is shown now and confirmed in the background.
+	auto cached = Cache.find(tMath::tHashString64(node->Path.Chars()));
+	if (cached != Cache.end())
+		Apply(node, cached->second);
+	node->State = Node::StateEnum::Listing;
+	Enqueue(node);
+}
+
+
+void FolderTree::Enqueue(Node* node)
+{
+	Job* job = new Job;
+	job->Dir = node->Path;
+	job->Extensions = Extensions;
+	auto cached = Cache.find(tMath::tHashString64(node->Path.Chars()));
+	if (cached != Cache.end())
+	{
+		job->HasKnownModTime = true;
+		job->KnownModTime = cached->second.ModTime;
+	}
+	Queue.Add(job);
+}
+
+
+void FolderTree::Apply(Node* node, const Listing& listing)
+{
+	node->HasCounts = true;
+	node->NumImages = listing.NumImages;
+	node->NumBytes = listing.NumBytes;
+
+	// Both lists are sorted so existing children are matched in a single pass. Matched children keep their own
+	// subtrees, which means expanded folders stay expanded when the parent is relisted.
+	Node* child = node->Children.First();
+	for (const tString& name : listing.SubDirs)
+	{
+		while (child && (DirScan::CompareNames(child->Name.Chars(), name.Chars()) < 0))
+		{
+			Node* next = child->Next();
+			DeleteChildren(child);
+			NodesByPath.erase(tMath::tHashString64(child->Path.Chars()));
+			delete node->Children.Remove(child);
+			child = next;
+		}
+
+		if (child && (child->Name == name))
+		{
+			child = child->Next();
+			continue;
+		}
+
+		Node* newChild = new Node;
+		newChild->Name = name;
+		newChild->Path = node->Path + name + "/";
+		newChild->Parent = node;
+		if (child)
+			node->Children.Insert(newChild, child);
+		else
+			node->Children.Append(newChild);
+		NodesByPath[tMath::tHashString64(newChild->Path.Chars())] = newChild;
+	}
+
+	while (child)
+	{
+		Node* next = child->Next();
+		DeleteChildren(child);
+		NodesByPath.erase(tMath::tHashString64(child->Path.Chars()));
+		delete node->Children.Remove(child);
+		child = next;
+	}
+}
+
+
+bool FolderTree::Update()
+{
+	if (!Queue.IsActive())
+		return false;
+
+	tList<Result> results;
+	Queue.TakeResults(results);
+
+	bool changed = false;
+	for (Result* result = results.First(); result; result = result->Next())
+	{
+		uint64 key = tMath::tHashString64(result->Dir.Chars());
+		if (result->Valid && !result->Unchanged)
+		{
+			// Rather than track use, the cache is simply dropped when it gets too big. It refills as folders are viewed.
+			if ((int(Cache.size()) >= MaxCacheEntries) && (Cache.find(key) == Cache.end()))
+				Cache.clear();
+			Cache[key] = result->Contents;
+		}
+		else if (!result->Valid)
+		{
+			Cache.erase(key);
+		}
+
+		// The node may have gone away, or the root may have changed, while the folder was being listed.
+		Node* node = FindNode(result->Dir);
+		if (!node)
+			continue;
+
+		node->State = Node::StateEnum::Listed;
+		if (!result->Unchanged)
+		{
+			Apply(node, result->Valid ? result->Contents : Listing());
+			changed = true;
+		}
+
+		// Only a stat if the folder hasn't changed since this listing, as the cache now has its mod time.
+		if (node->RelistPending)
+		{
+			node->RelistPending = false;
+			Refresh(node);
+		}
+	}
+
+	return changed;
+}
+
+
+void FolderTree::List(Result& result, const Job& job)
+{
+	result.Dir = job.Dir;
+	std::time_t dirModTime = 0;
+	uint64 dirSize = 0;
+	if (!StatFetcher::GetFileStat(job.Dir, dirModTime, dirSize))
+		return;
+
+	result.Valid = true;
+	result.Contents.ModTime = dirModTime;
+	if (job.HasKnownModTime && (dirModTime == job.KnownModTime))
+	{
+		result.Unchanged = true;
+		return;
+	}
+
+	DirScan scan;
+	if (!scan.Scan(result.Dir, job.Extensions))
+	{
+		result.Valid = false;
+		return;
+	}
+
+	// Sizes come with the enumeration where the platform provides them. The rest need a stat each.
+	result.Contents.NumImages = scan.GetNumFiles();
+	for (int f = 0; f < scan.GetNumFiles(); f++)
+	{
+		std::time_t modTime;
+		uint64 fileSize = 0;
+		if (scan.GetFileInfo(f, modTime, fileSize) || StatFetcher::GetFileStat(scan.GetFilePath(f), modTime, fileSize))
+			result.Contents.NumBytes += fileSize;
+	}
+
+	std::vector<const char*> names(scan.GetNumSubDirs());
+	for (int d = 0; d < scan.GetNumSubDirs(); d++)
+		names[d] = scan.GetSubDirName(d);
+	std::sort(names.begin(), names.end(), [](const char* a, const char* b) { return DirScan::CompareNames(a, b) < 0; });
+	result.Contents.SubDirs.reserve(names.size());
+	for (const char* name : names)
+		result.Contents.SubDirs.push_back(tString(name));
+}
+
@@ -0,0 +1,113 @@
+// FolderTree.h
+//
+// The subfolders of the images folder as a lazily expanded tree. Folders are listed on worker threads and each one
+// reports how many images it holds and their total size.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <ctime>
+#include <vector>
+#include <unordered_map>
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+#include "BackgroundQueue.h"
+class ExtensionSet;
+
+
+// A folder is only listed when it becomes visible, which is when its parent is expanded. Listings are cached on the
+// main thread along with the folder mod time. A cached listing is shown straight away and the worker then only has to
+// stat the folder to confirm it. Adding, removing or renaming an entry changes the mod time, but a file being edited in
+// place does not, so the byte count may lag until something else in the folder changes.
+class FolderTree
+{
+public:
+	FolderTree()																										: Queue(MaxWorkers, List) { }
+	~FolderTree()																										{ Cancel(); Clear(); }
+
+	struct Node : public tLink<Node>
+	{
+		enum class StateEnum
+		{
+			Unlisted,
+			Listing,
+			Listed
+		};
+
+		tString Name;
+		tString Path;									// Ends with a slash.
+		Node* Parent						= nullptr;
+		tList<Node> Children;							// Sorted by name. Empty until listed.
+		StateEnum State						= StateEnum::Unlisted;
+		bool RelistPending					= false;	// Refreshed while listing. The listing may predate the change.
+		bool HasCounts						= false;	// The counts below are for images directly in this folder.
+		int NumImages						= 0;
+		uint64 NumBytes						= 0;
+	};
+
+	// Rebuilds the tree if the root changed and always asks for the root to be relisted. The extension set decides what
+	// counts as an image and must outlive the tree.
+	void SetRoot(const tString& rootDir, const ExtensionSet*);
+	void Clear();
+	void Cancel();										// Abandons the workers. Listings underway are lost.
+	Node* GetRoot()																										{ return Root; }
+
+	// Queues a listing of an unlisted node. Nodes that are already listed or being listed are left alone.
+	void Request(Node*);
+
+	// Relists a node even if it was listed already. The cached listing still lets unchanged folders skip enumeration. If
+	// the node is being listed it is listed again once that listing lands.
+	void Refresh(Node*);
+
+	// Call once per frame. Applies finished listings to the cache and the tree. Returns true if the tree changed.
+	bool Update();
+
+	const static int MaxWorkers;		// = 2;
+	const static int MaxCacheEntries;	// = 65536;
+
+private:
+	FolderTree(const FolderTree&) = delete;
+	FolderTree& operator=(const FolderTree&) = delete;
+
+	struct Listing
+	{
+		std::time_t ModTime					= 0;
+		std::vector<tString> SubDirs;					// Sorted.
+		int NumImages						= 0;
+		uint64 NumBytes						= 0;
+	};
+	struct Job : public tLink<Job>
+	{
+		tString Dir;
+		const ExtensionSet* Extensions		= nullptr;
+		bool HasKnownModTime				= false;
+		std::time_t KnownModTime			= 0;
+	};
+	struct Result : public tLink<Result>
+	{
+		tString Dir;
+		bool Valid							= false;	// False if the folder couldn't be read.
+		bool Unchanged						= false;	// The mod time matched the known one so nothing was enumerated.
+		Listing Contents;
+	};
+	static void List(Result&, const Job&);
+
+	void Enqueue(Node*);
+	void Apply(Node*, const Listing&);
+	void DeleteChildren(Node*);
+	Node* FindNode(const tString& path) const;
+
+	BackgroundQueue<Job, Result> Queue;
+	const ExtensionSet* Extensions			= nullptr;
+	Node* Root								= nullptr;
+	std::unordered_map<uint64, Node*> NodesByPath;
+	std::unordered_map<uint64, Listing> Cache;		// Keyed on the hashed path.
+};
@@ -0,0 +1,304 @@
+// GifFrame.cpp
+//
+// Decodes just the first frame of a gif. The full gif loader decodes every frame up front, which for a long animation
+// costs seconds and gigabytes when all that's wanted is a thumbnail.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <cstdio>
+#include <vector>
+#include "GifFrame.h"
+using namespace tImage;
+
+
+namespace
+{
+	// Buffered byte reader. Running off the end sets a flag rather than failing each call, so the parser can check once
+	// per block.
+	class ByteReader
+	{
+	public:
+		ByteReader(FILE* file)																							: File(file) { }
+
+		uint8 Get()
+		{
+			if (Pos == Size)
+			{
+				Size = int(fread(Buffer, 1, BufferSize, File));
+				Pos = 0;
+				if (Size <= 0)
+				{
+					Size = 0;
+					Eof = true;
+					return 0;
+				}
+			}
+			return Buffer[Pos++];
+		}
+		int Get16()																										{ int lo = Get(); return lo | (Get() << 8); }
+		void Skip(int count)																							{ for (int c = 0; c < count; c++) Get(); }
+		bool IsEof() const																								{ return Eof; }
+
+	private:
+		static const int BufferSize = 16384;
+		FILE* File;
+		uint8 Buffer[BufferSize];
+		int Pos = 0;
+		int Size = 0;
+		bool Eof = false;
+	};
+
+
+	// Skips a chain of data sub-blocks, up to and including the zero length terminator.
+	void SkipSubBlocks(ByteReader& reader)
+	{
+		int size = reader.Get();
+		while ((size > 0) && !reader.IsEof())
+		{
+			reader.Skip(size);
+			size = reader.Get();
+		}
+	}
+
+
+	// Decodes the lzw stream of one frame into colour indices. Returns how many were decoded, which is fewer than
+	// numIndices if the stream ends early, or -1 if it is malformed.
+	int DecodeLZW(ByteReader& reader, int minCodeSize, uint8* indices, int numIndices)
+	{
+		const int MaxCodes = 4096;
+		if ((minCodeSize < 2) || (minCodeSize > 11))
+			return -1;
+
+		std::vector<uint16> prefix(MaxCodes);
+		std::vector<uint8> suffix(MaxCodes);
+		std::vector<uint8> stack(MaxCodes + 1);
+		int clearCode = 1 << minCodeSize;
+		int endCode = clearCode + 1;
+		for (int c = 0; c < clearCode; c++)
+		{
+			prefix[c] = 0xFFFF;
+			suffix[c] = uint8(c);
+		}
+
+		int codeSize = minCodeSize + 1;
+		int nextCode = endCode + 1;
+		int prevCode = -1;
+		uint8 firstChar = 0;
+		uint32 bits = 0;
+		int numBits = 0;
+		int blockLeft = reader.Get();
+		int out = 0;
+
+		while (out < numIndices)
+		{
+			// Gather enough bits for the next code, moving on to the next sub-block as needed.
+			while (numBits < codeSize)
+			{
+				if (blockLeft == 0)
+				{
+					blockLeft = reader.Get();
+					if ((blockLeft == 0) || reader.IsEof())
+						return out;
+				}
+				bits |= uint32(reader.Get()) << numBits;
+				numBits += 8;
+				blockLeft--;
+			}
+			int code = bits & ((1 << codeSize) - 1);
+			bits >>= codeSize;
+			numBits -= codeSize;
+
+			if (code == clearCode)
+			{
+				codeSize = minCodeSize + 1;
+				nextCode = endCode + 1;
+				prevCode = -1;
+				continue;
+			}
+			if (code == endCode)
+				break;
+
+			// A code one past the table is the previous string plus its own first character.
+			int curr = code;
+			int top = 0;
+			if (code >= nextCode)
+			{
+				if ((code > nextCode) || (prevCode < 0))
+					return -1;
+				stack[top++] = firstChar;
+				curr = prevCode;
+			}
+			while (curr >= clearCode)
+			{
+				if ((curr >= MaxCodes) || (top >= MaxCodes))
+					return -1;
+				stack[top++] = suffix[curr];
+				curr = prefix[curr];
+			}
+			firstChar = uint8(curr);
+			stack[top++] = firstChar;
+
+			while ((top > 0) && (out < numIndices))
+				indices[out++] = stack[--top];
+
+			if ((prevCode >= 0) && (nextCode < MaxCodes))
+			{
+				prefix[nextCode] = uint16(prevCode);
+				suffix[nextCode] = firstChar;
+				nextCode++;
+				if ((nextCode == (1 << codeSize)) && (codeSize < 12))
+					codeSize++;
+			}
+			prevCode = code;
+		}
+
+		// Whatever remains of the frame data is not needed.
+		if (blockLeft > 0)
+			reader.Skip(blockLeft);
+		SkipSubBlocks(reader);
+		return out;
+	}
+}
+
+
+bool LoadGifFirstFrame(tPicture& picture, const tString& filename)
+{
+	FILE* file = fopen(filename.Chars(), "rb");
+	if (!file)
+		return false;
+
+	ByteReader reader(file);
+	uint8 signature[6];
+	for (int s = 0; s < 6; s++)
+		signature[s] = reader.Get();
+	int width = reader.Get16();
+	int height = reader.Get16();
+	int flags = reader.Get();
+	reader.Skip(2);
+	bool validHeader =
+		!reader.IsEof() && (tMemcmp(signature, "GIF8", 4) == 0) && (width > 0) && (height > 0) &&
+		(width <= 16384) && (height <= 16384);
+	if (!validHeader)
+	{
+		fclose(file);
+		return false;
+	}
+
+	uint8 globalPalette[256][3] = { };
+	if (flags & 0x80)
+	{
+		int numColours = 2 << (flags & 0x07);
+		for (int c = 0; c < numColours; c++)
+			for (int ch = 0; ch < 3; ch++)
+				globalPalette[c][ch] = reader.Get();
+	}
+
+	int transparentIndex = -1;
+	bool ok = false;
+	while (!reader.IsEof())
+	{
+		int blockType = reader.Get();
+		if (blockType == 0x21)
+		{
+			// Only the graphic control extension matters. It carries the transparent colour of the next frame.
+			int label = reader.Get();
+			if (label == 0xF9)
+			{
+				int size = reader.Get();
+				int gcFlags = reader.Get();
+				reader.Skip(2);
+				int index = reader.Get();
+				reader.Skip(size - 4);
+				transparentIndex = (gcFlags & 0x01) ? index : -1;
+			}
+			SkipSubBlocks(reader);
+			continue;
+		}
+		if (blockType != 0x2C)
+			break;
+
+		int frameX = reader.Get16();
+		int frameY = reader.Get16();
+		int frameW = reader.Get16();
+		int frameH = reader.Get16();
+		int frameFlags = reader.Get();
+		uint8 localPalette[256][3] = { };
+		uint8 (*palette)[3] = globalPalette;
+		if (frameFlags & 0x80)
+		{
+			int numColours = 2 << (frameFlags & 0x07);
+			for (int c = 0; c < numColours; c++)
+				for (int ch = 0; ch < 3; ch++)
+					localPalette[c][ch] = reader.Get();
+			palette = localPalette;
+		}
+
+		int minCodeSize = reader.Get();
+		if (reader.IsEof() || (frameW <= 0) || (frameH <= 0))
+			break;
+
+		// The descriptor values are unchecked 16 bit numbers. A frame that doesn't fit on the logical screen is
+		// rejected before anything is allocated for it, so the frame is never bigger than the (already limited) screen.
+		if ((int64(frameX) + frameW > width) || (int64(frameY) + frameH > height))
+			break;
+
+		// Pixels a truncated stream didn't reach are left transparent, as browsers do.
+		int numIndices = int(int64(frameW) * int64(frameH));
+		std::vector<uint8> indices(numIndices);
+		int numDecoded = DecodeLZW(reader, minCodeSize, indices.data(), numIndices);
+		if (numDecoded < 0)
+			break;
+
+		// Interlaced frames store rows in four passes.
+		std::vector<int> rowOrder(frameH);
+		if (frameFlags & 0x40)
+		{
+			int r = 0;
+			const int passStart[4] = { 0, 4, 2, 1 };
+			const int passStep[4] = { 8, 8, 4, 2 };
+			for (int pass = 0; pass < 4; pass++)
+				for (int y = passStart[pass]; y < frameH; y += passStep[pass])
+					rowOrder[r++] = y;
+		}
+		else
+		{
+			for (int y = 0; y < frameH; y++)
+				rowOrder[y] = y;
+		}
+
+		// Pictures are stored bottom-up.
+		tPixel* pixels = new tPixel[width * height];
+		tMemset(pixels, 0, width * height * sizeof(tPixel));
+		for (int r = 0; r < frameH; r++)
+		{
+			int y = frameY + rowOrder[r];
+			if (y >= height)
+				continue;
+			const uint8* rowIndices = indices.data() + r * frameW;
+			tPixel* row = pixels + (height - 1 - y) * width;
+			for (int x = 0; (x < frameW) && (frameX + x < width) && (r*frameW + x < numDecoded); x++)
+			{
+				int index = rowIndices[x];
+				if (index == transparentIndex)
+					continue;
+				row[frameX + x] = tPixel(palette[index][0], palette[index][1], palette[index][2], 255);
+			}
+		}
+
+		// The picture takes ownership of the pixels.
+		picture.Set(width, height, pixels, false);
+		ok = true;
+		break;
+	}
+
+	fclose(file);
+	return ok;
+}
@@ -0,0 +1,24 @@
+// GifFrame.h
+//
+// Decodes just the first frame of a gif. The full gif loader decodes every frame up front, which for a long animation
+// costs seconds and gigabytes when all that's wanted is a thumbnail.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tString.h>
+#include <Image/tPicture.h>
+
+
+// The frame is drawn onto a canvas the size of the logical screen, with everything it doesn't cover left transparent.
+// That matches the first frame the full loader produces. Only the file up to the end of the first frame is read.
+// Returns false if the file isn't a gif or is damaged before the first frame ends. Safe to call from any thread.
+bool LoadGifFirstFrame(tImage::tPicture&, const tString& filename);
@@ -0,0 +1,171 @@
+// HeaderCache.cpp
+//
+// Persistent store of probed image headers so dimensions, formats and capture dates survive between runs.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <vector>
+#include <algorithm>
+#include <System/tFile.h>
+#include <Math/tHash.h>
+#include "HeaderCache.h"
+using namespace tSystem;
+
+
+const int HeaderCache::MaxRecords = 262144;
+
+
+namespace
+{
+	// Layout of the cache file. The header is followed by the records.
+	struct CacheHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 Session;
+		int32 NumRecords;
+	};
+	struct CacheRecord
+	{
+		uint64 Key;
+		int64 CaptureTime;
+		int32 Width;
+		int32 Height;
+		int32 PixelFormat;
+		uint32 LastUsed;
+	};
+	const uint32 CacheMagic = 0x43485654;		// 'TVHC' little-endian.
+	const uint32 CacheVersion = 1;
+}
+
+
+uint64 HeaderCache::ComputeKey(const tString& filename, std::time_t modTime, uint64 fileSize)
+{
+	int64 time = int64(modTime);
+	uint64 key = tMath::tHashString64(filename.Chars());
+	key = tMath::tHashData64((uint8*)&time, sizeof(time), key);
+	key = tMath::tHashData64((uint8*)&fileSize, sizeof(fileSize), key);
+	return key;
+}
+
+
+bool HeaderCache::Load(const tString& cacheFile)
+{
+	Records.clear();
+	Dirty = false;
+	if (!tFileExists(cacheFile))
+		return false;
+
+	int fileSize = 0;
+	uint8* data = tLoadFile(cacheFile, nullptr, &fileSize);
+	if (!data)
+		return false;
+
+	bool ok = false;
+	const CacheHeader* header = (const CacheHeader*)data;
+	if
+	(
+		(fileSize >= int(sizeof(CacheHeader))) && (header->Magic == CacheMagic) && (header->Version == CacheVersion) &&
+		(header->NumRecords >= 0) &&
+		(int64(fileSize) == int64(sizeof(CacheHeader)) + int64(header->NumRecords)*int64(sizeof(CacheRecord)))
+	)
+	{
+		// Each run is a new session. Records touched this run get the new number.
+		Session = header->Session + 1;
+		const CacheRecord* records = (const CacheRecord*)(data + sizeof(CacheHeader));
+		Records.reserve(header->NumRecords);
+		for (int r = 0; r < header->NumRecords; r++)
+		{
+			Record& record = Records[records[r].Key];
+			record.Header.Width = records[r].Width;
+			record.Header.Height = records[r].Height;
+			record.Header.PixelFormat = tImage::tPixelFormat(records[r].PixelFormat);
+			record.Header.CaptureTime = records[r].CaptureTime;
+			record.LastUsed = records[r].LastUsed;
+		}
+		ok = true;
+	}
+
+	delete[] data;
+	return ok;
+}
+
+
+bool HeaderCache::Save(const tString& cacheFile)
+{
+	if (!Dirty)
+		return true;
+
+	std::vector<CacheRecord> records;
+	records.reserve(Records.size());
+	for (const auto& keyRecord : Records)
+	{
+		CacheRecord record;
+		record.Key = keyRecord.first;
+		record.CaptureTime = keyRecord.second.Header.CaptureTime;
+		record.Width = keyRecord.second.Header.Width;
+		record.Height = keyRecord.second.Header.Height;
+		record.PixelFormat = int32(keyRecord.second.Header.PixelFormat);
+		record.LastUsed = keyRecord.second.LastUsed;
+		records.push_back(record);
+	}
+
+	if (int(records.size()) > MaxRecords)
+	{
+		std::nth_element
+		(
+			records.begin(), records.begin() + MaxRecords, records.end(),
+			[](const CacheRecord& a, const CacheRecord& b) { return a.LastUsed > b.LastUsed; }
+		);
+		records.resize(MaxRecords);
+	}
+
+	int recordsSize = int(records.size()) * sizeof(CacheRecord);
+	int fileSize = sizeof(CacheHeader) + recordsSize;
+	uint8* data = new uint8[fileSize];
+	CacheHeader* header = (CacheHeader*)data;
+	header->Magic = CacheMagic;
+	header->Version = CacheVersion;
+	header->Session = Session;
+	header->NumRecords = int32(records.size());
+	if (recordsSize > 0)
+		tMemcpy(data + sizeof(CacheHeader), records.data(), recordsSize);
+
+	bool ok = tCreateFile(cacheFile, data, fileSize);
+	if (!ok)
+		tPrintf("Warning: Unable to write header cache %s\n", cacheFile.Chars());
+	else
+		Dirty = false;
+	delete[] data;
+	return ok;
+}
+
+
+bool HeaderCache::Find(ImageHeader& header, const tString& filename, std::time_t modTime, uint64 fileSize)
+{
+	auto found = Records.find(ComputeKey(filename, modTime, fileSize));
+	if (found == Records.end())
+		return false;
+
+	// Not worth a save on its own. It is written out with the next addition.
+	found->second.LastUsed = Session;
+	header = found->second.Header;
+	return true;
+}
+
+
+void HeaderCache::Add(const ImageHeader& header, const tString& filename, std::time_t modTime, uint64 fileSize)
+{
+	Record& record = Records[ComputeKey(filename, modTime, fileSize)];
+	record.Header = header;
+	record.LastUsed = Session;
+	Dirty = true;
+}
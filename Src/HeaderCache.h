@@ -0,0 +1,53 @@
+// HeaderCache.h
+//
+// Persistent store of probed image headers so dimensions, formats and capture dates survive between runs.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <ctime>
+#include <unordered_map>
+#include <Foundation/tString.h>
+#include "HeaderProbe.h"
+
+
+// Records are keyed on the path, mod time and size so an edited file simply misses. Failed probes are stored too so
+// unrecognised files aren't read again every run. Only used from the main thread.
+class HeaderCache
+{
+public:
+	HeaderCache()																										{ }
+
+	// Load replaces the contents. A missing or out of date file just leaves the cache empty.
+	bool Load(const tString& cacheFile);
+
+	// Only writes if something was added. When over MaxRecords the least recently used records are dropped.
+	bool Save(const tString& cacheFile);
+
+	// Returns false on a miss. A hit may still be an invalid header if the probe failed.
+	bool Find(ImageHeader&, const tString& filename, std::time_t modTime, uint64 fileSize);
+	void Add(const ImageHeader&, const tString& filename, std::time_t modTime, uint64 fileSize);
+	int GetNumRecords() const																							{ return int(Records.size()); }
+
+	const static int MaxRecords;		// = 262144;
+
+private:
+	static uint64 ComputeKey(const tString& filename, std::time_t modTime, uint64 fileSize);
+
+	struct Record
+	{
+		ImageHeader Header;
+		uint32 LastUsed;				// Session number.
+	};
+	std::unordered_map<uint64, Record> Records;
+	uint32 Session						= 1;
+	bool Dirty							= false;
+};
@@ -0,0 +1,600 @@
+// HeaderProbe.cpp
+//
+// Reads just the header of an image file to find its dimensions and pixel format without decoding it. A background
+// prober runs this over a whole folder.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <cstdio>
+#include <Foundation/tStandard.h>
+#include <Math/tFundamentals.h>
+#include <System/tFile.h>
+#include "HeaderProbe.h"
+using namespace tImage;
+
+
+const int HeaderProber::HeaderBlockSize = 4096;
+const int HeaderProber::MaxWorkers = 4;
+
+
+namespace
+{
+	inline uint32 GetLE16(const uint8* p)																				{ return uint32(p[0]) | (uint32(p[1]) << 8); }
+	inline uint32 GetLE24(const uint8* p)																				{ return GetLE16(p) | (uint32(p[2]) << 16); }
+	inline uint32 GetLE32(const uint8* p)																				{ return GetLE16(p) | (GetLE16(p+2) << 16); }
+	inline uint32 GetBE16(const uint8* p)																				{ return (uint32(p[0]) << 8) | uint32(p[1]); }
+	inline uint32 GetBE32(const uint8* p)																				{ return (GetBE16(p) << 16) | GetBE16(p+2); }
+
+	// The first block of the file is read once up front. Reads that fall inside it are served from memory. Anything
+	// further in costs a seek and a small read.
+	class HeaderReader
+	{
+	public:
+		HeaderReader(FILE* file)																						: File(file) { BlockSize = int(fread(Block, 1, HeaderProber::HeaderBlockSize, file)); }
+
+		const uint8* GetBlock() const																					{ return Block; }
+		int GetBlockSize() const																						{ return BlockSize; }
+
+		// Returns the number of bytes read, which may be fewer than count at the end of the file.
+		int ReadSome(int64 offset, uint8* dest, int count)
+		{
+			if ((offset < 0) || (count <= 0))
+				return 0;
+
+			if (offset + count <= BlockSize)
+			{
+				tMemcpy(dest, Block + offset, count);
+				return count;
+			}
+
+			if ((offset > 0x7FFFFFFF) || (fseek(File, long(offset), SEEK_SET) != 0))
+				return 0;
+			return int(fread(dest, 1, count, File));
+		}
+		bool Read(int64 offset, uint8* dest, int count)																	{ return ReadSome(offset, dest, count) == count; }
+
+	private:
+		FILE* File;
+		uint8 Block[HeaderProber::HeaderBlockSize];
+		int BlockSize = 0;
+	};
+
+
+	// One image file directory of a tiff structure. Exif blocks use the same layout starting partway into the file so
+	// offsets stored in the directory are relative to a base.
+	class TiffDir
+	{
+	public:
+		TiffDir(bool littleEndian)																						: LittleEndian(littleEndian) { }
+		bool Read(HeaderReader& reader, int64 base, int64 dirOffset)
+		{
+			uint8 countBytes[2];
+			if (!reader.Read(base + dirOffset, countBytes, 2))
+				return false;
+			NumEntries = tMath::tMin(int(Get16(countBytes)), MaxEntries);
+			return reader.Read(base + dirOffset + 2, Entries, NumEntries*EntrySize);
+		}
+
+		// Returns null if the tag isn't present.
+		const uint8* Find(uint32 tag) const
+		{
+			for (int e = 0; e < NumEntries; e++)
+				if (Get16(Entries + e*EntrySize) == tag)
+					return Entries + e*EntrySize;
+			return nullptr;
+		}
+
+		// For short and long entries. Shorts are left-justified in the value field.
+		uint32 GetValue(const uint8* entry) const																		{ return (Get16(entry + 2) == 3) ? Get16(entry + 8) : Get32(entry + 8); }
+		uint32 Get16(const uint8* p) const																				{ return LittleEndian ? GetLE16(p) : GetBE16(p); }
+		uint32 Get32(const uint8* p) const																				{ return LittleEndian ? GetLE32(p) : GetBE32(p); }
+
+	private:
+		const static int MaxEntries		= 256;
+		const static int EntrySize		= 12;
+		bool LittleEndian;
+		uint8 Entries[MaxEntries*EntrySize];
+		int NumEntries					= 0;
+	};
+
+
+	// Exif dates are "YYYY:MM:DD HH:MM:SS" with no time zone. They're converted as if they were UTC, which keeps the
+	// order right and is all sorting needs.
+	int64 ParseExifDate(const char* text)
+	{
+		int year, month, day, hour, minute, second;
+		if (sscanf(text, "%4d:%2d:%2d %2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6)
+			return 0;
+		if ((year < 1800) || (month < 1) || (month > 12) || (day < 1) || (day > 31))
+			return 0;
+
+		// Days since 1970-01-01 in the proleptic Gregorian calendar.
+		int y = year - ((month <= 2) ? 1 : 0);
+		int era = ((y >= 0) ? y : y - 399) / 400;
+		int yearOfEra = y - era*400;
+		int dayOfYear = (153*(month + ((month > 2) ? -3 : 9)) + 2)/5 + day - 1;
+		int dayOfEra = yearOfEra*365 + yearOfEra/4 - yearOfEra/100 + dayOfYear;
+		int64 days = int64(era)*146097 + dayOfEra - 719468;
+		return days*86400 + hour*3600 + minute*60 + second;
+	}
+
+
+	int64 ReadExifDate(HeaderReader& reader, const TiffDir& dir, int64 base, uint32 tag)
+	{
+		// Always 20 ascii characters including the terminator so the value field is an offset.
+		const uint8* entry = dir.Find(tag);
+		if (!entry || (dir.Get16(entry + 2) != 2) || (dir.Get32(entry + 4) < 19))
+			return 0;
+
+		char text[20];
+		if (!reader.Read(base + dir.Get32(entry + 8), (uint8*)text, 19))
+			return 0;
+		text[19] = '\0';
+		return ParseExifDate(text);
+	}
+
+
+	// The capture date is the original date in the exif directory, then the digitized date, and finally the date in
+	// the main directory, which editors tend to overwrite. Returns 0 if there isn't one.
+	int64 ReadCaptureTime(HeaderReader& reader, const TiffDir& mainDir, int64 base, bool littleEndian)
+	{
+		const uint32 tagDateTime			= 0x0132;
+		const uint32 tagExifDir				= 0x8769;
+		const uint32 tagDateTimeOriginal	= 0x9003;
+		const uint32 tagDateTimeDigitized	= 0x9004;
+
+		int64 captureTime = 0;
+		const uint8* exifEntry = mainDir.Find(tagExifDir);
+		TiffDir exifDir(littleEndian);
+		if (exifEntry && exifDir.Read(reader, base, mainDir.Get32(exifEntry + 8)))
+		{
+			captureTime = ReadExifDate(reader, exifDir, base, tagDateTimeOriginal);
+			if (!captureTime)
+				captureTime = ReadExifDate(reader, exifDir, base, tagDateTimeDigitized);
+		}
+		if (!captureTime)
+			captureTime = ReadExifDate(reader, mainDir, base, tagDateTime);
+		return captureTime;
+	}
+
+
+	bool ProbePNG(ImageHeader& header, HeaderReader& reader)
+	{
+		// The IHDR chunk must come first.
+		const uint8* b = reader.GetBlock();
+		if ((reader.GetBlockSize() < 26) || (tMemcmp((const char*)b + 12, "IHDR", 4) != 0))
+			return false;
+
+		header.Width = int(GetBE32(b + 16));
+		header.Height = int(GetBE32(b + 20));
+		switch (b[25])
+		{
+			case 3:		header.PixelFormat = tPixelFormat::PAL8BIT;		break;
+			case 4:
+			case 6:		header.PixelFormat = tPixelFormat::R8G8B8A8;	break;
+			default:	header.PixelFormat = tPixelFormat::R8G8B8;		break;
+		}
+		return true;
+	}
+
+
+	bool ProbeJPG(ImageHeader& header, HeaderReader& reader)
+	{
+		// Walk the marker segments until a start-of-frame, picking up the capture date on the way. Exif and thumbnail
+		// segments can be large, which is why the reader may need to seek past the first block.
+		const int maxSegments = 256;
+		int64 offset = 2;
+		for (int s = 0; s < maxSegments; s++)
+		{
+			uint8 seg[10];
+			if (!reader.Read(offset, seg, 4) || (seg[0] != 0xFF))
+				return false;
+
+			uint8 marker = seg[1];
+			if (marker == 0xFF)
+			{
+				offset++;
+				continue;
+			}
+
+			// End of image or start of scan without a frame header means a broken file.
+			if ((marker == 0xD9) || (marker == 0xDA))
+				return false;
+
+			// Standalone markers have no length.
+			if ((marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD8)))
+			{
+				offset += 2;
+				continue;
+			}
+
+			// SOF0 to SOF15 except DHT, JPG and DAC, which share the range.
+			bool frame = (marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC);
+			if (frame)
+			{
+				if (!reader.Read(offset, seg, 10))
+					return false;
+				header.Height = int(GetBE16(seg + 5));
+				header.Width = int(GetBE16(seg + 7));
+				header.PixelFormat = tPixelFormat::R8G8B8;
+				return true;
+			}
+
+			// The exif block is a tiff structure that starts after the Exif identifier.
+			uint8 id[8];
+			if ((marker == 0xE1) && !header.CaptureTime && reader.Read(offset + 4, id, 8) && (tMemcmp(id, "Exif\0\0", 6) == 0))
+			{
+				int64 base = offset + 10;
+				bool le = (id[6] == 'I');
+				uint8 tiffHeader[8];
+				TiffDir dir(le);
+				if (reader.Read(base, tiffHeader, 8) && dir.Read(reader, base, dir.Get32(tiffHeader + 4)))
+					header.CaptureTime = ReadCaptureTime(reader, dir, base, le);
+			}
+
+			offset += 2 + GetBE16(seg + 2);
+		}
+		return false;
+	}
+
+
+	bool ProbeGIF(ImageHeader& header, HeaderReader& reader)
+	{
+		const uint8* b = reader.GetBlock();
+		if (reader.GetBlockSize() < 10)
+			return false;
+
+		header.Width = int(GetLE16(b + 6));
+		header.Height = int(GetLE16(b + 8));
+		header.PixelFormat = tPixelFormat::PAL8BIT;
+		return true;
+	}
+
+
+	bool ProbeWEBP(ImageHeader& header, HeaderReader& reader)
+	{
+		const uint8* b = reader.GetBlock();
+		if (reader.GetBlockSize() < 30)
+			return false;
+
+		bool alpha = false;
+		const char* chunk = (const char*)b + 12;
+		if (tMemcmp(chunk, "VP8 ", 4) == 0)
+		{
+			// Lossy. The frame tag is followed by a start code and then the 14 bit dimensions.
+			if ((b[23] != 0x9D) || (b[24] != 0x01) || (b[25] != 0x2A))
+				return false;
+			header.Width = int(GetLE16(b + 26) & 0x3FFF);
+			header.Height = int(GetLE16(b + 28) & 0x3FFF);
+		}
+		else if (tMemcmp(chunk, "VP8L", 4) == 0)
+		{
+			// Lossless. Width and height minus one are packed into 14 bits each, followed by the alpha hint.
+			if (b[20] != 0x2F)
+				return false;
+			uint32 bits = GetLE32(b + 21);
+			header.Width = int(bits & 0x3FFF) + 1;
+			header.Height = int((bits >> 14) & 0x3FFF) + 1;
+			alpha = ((bits >> 28) & 1) != 0;
+		}
+		else if (tMemcmp(chunk, "VP8X", 4) == 0)
+		{
+			// Extended. Used for animation and alpha. The canvas size is stored minus one in 24 bits.
+			alpha = (b[20] & 0x10) != 0;
+			header.Width = int(GetLE24(b + 24)) + 1;
+			header.Height = int(GetLE24(b + 27)) + 1;
+		}
+		else
+		{
+			return false;
+		}
+
+		header.PixelFormat = alpha ? tPixelFormat::R8G8B8A8 : tPixelFormat::R8G8B8;
+		return true;
+	}
+
+
+	bool ProbeTGA(ImageHeader& header, HeaderReader& reader)
+	{
+		const uint8* b = reader.GetBlock();
+		if (reader.GetBlockSize() < 18)
+			return false;
+
+		// With no signature the best we can do is reject headers that can't be right.
+		uint8 imageType = b[2];
+		bool knownType = (imageType == 1) || (imageType == 2) || (imageType == 3) || (imageType == 9) || (imageType == 10) || (imageType == 11);
+		if (!knownType || (b[1] > 1))
+			return false;
+
+		header.Width = int(GetLE16(b + 12));
+		header.Height = int(GetLE16(b + 14));
+		switch (b[16])
+		{
+			case 32:	header.PixelFormat = tPixelFormat::B8G8R8A8;	break;
+			case 24:	header.PixelFormat = tPixelFormat::B8G8R8;		break;
+			case 16:	header.PixelFormat = tPixelFormat::G3B5A1R5G2;	break;
+			case 8:		header.PixelFormat = tPixelFormat::PAL8BIT;		break;
+			default:	return false;
+		}
+		return true;
+	}
+
+
+	bool ProbeTIF(ImageHeader& header, HeaderReader& reader)
+	{
+		const uint8* b = reader.GetBlock();
+		if (reader.GetBlockSize() < 8)
+			return false;
+
+		// Only the first directory is read. It describes the primary page.
+		bool le = (b[0] == 'I');
+		TiffDir dir(le);
+		if (!dir.Read(reader, 0, dir.Get32(b + 4)))
+			return false;
+
+		const uint8* width = dir.Find(256);
+		const uint8* height = dir.Find(257);
+		const uint8* samplesPerPixel = dir.Find(277);
+		if (!width || !height)
+			return false;
+
+		header.Width = int(dir.GetValue(width));
+		header.Height = int(dir.GetValue(height));
+		header.PixelFormat = (samplesPerPixel && (dir.GetValue(samplesPerPixel) >= 4)) ? tPixelFormat::R8G8B8A8 : tPixelFormat::R8G8B8;
+		header.CaptureTime = ReadCaptureTime(reader, dir, 0, le);
+		return header.IsValid();
+	}
+
+
+	bool ProbeBMP(ImageHeader& header, HeaderReader& reader)
+	{
+		const uint8* b = reader.GetBlock();
+		if (reader.GetBlockSize() < 30)
+			return false;
+
+		// The old OS/2 core header has 16 bit dimensions. Every later header has signed 32 bit ones, where a negative
+		// height means the rows are stored top-down.
+		int bitsPerPixel = 0;
+		if (GetLE32(b + 14) == 12)
+		{
+			header.Width = int(GetLE16(b + 18));
+			header.Height = int(GetLE16(b + 20));
+			bitsPerPixel = int(GetLE16(b + 24));
+		}
+		else
+		{
+			header.Width = int(GetLE32(b + 18));
+			header.Height = tMath::tAbs(int(GetLE32(b + 22)));
+			bitsPerPixel = int(GetLE16(b + 28));
+		}
+
+		switch (bitsPerPixel)
+		{
+			case 32:	header.PixelFormat = tPixelFormat::R8G8B8A8;	break;
+			case 24:	header.PixelFormat = tPixelFormat::R8G8B8;		break;
+			case 16:	header.PixelFormat = tPixelFormat::G3B5R5G3;	break;
+			default:	header.PixelFormat = tPixelFormat::PAL8BIT;		break;
+		}
+		return true;
+	}
+
+
+	bool ProbeDDS(ImageHeader& header, HeaderReader& reader)
+	{
+		const uint8* b = reader.GetBlock();
+		if (reader.GetBlockSize() < 128)
+			return false;
+
+		header.Height = int(GetLE32(b + 12));
+		header.Width = int(GetLE32(b + 16));
+
+		// The pixel format block starts at 76.
+		const uint32 flagAlphaPixels = 0x01;
+		const uint32 flagFourCC = 0x04;
+		uint32 flags = GetLE32(b + 80);
+		if (flags & flagFourCC)
+		{
+			const char* fourCC = (const char*)b + 84;
+			if (tMemcmp(fourCC, "DXT1", 4) == 0)
+				header.PixelFormat = tPixelFormat::BC1_DXT1;
+			else if ((tMemcmp(fourCC, "DXT2", 4) == 0) || (tMemcmp(fourCC, "DXT3", 4) == 0))
+				header.PixelFormat = tPixelFormat::BC2_DXT3;
+			else if ((tMemcmp(fourCC, "DXT4", 4) == 0) || (tMemcmp(fourCC, "DXT5", 4) == 0))
+				header.PixelFormat = tPixelFormat::BC3_DXT5;
+
+			// Float formats use the D3DFORMAT number in place of a four character code.
+			else if (GetLE32(b + 84) == 113)
+				header.PixelFormat = tPixelFormat::R16G16B16A16F;
+			else if (GetLE32(b + 84) == 116)
+				header.PixelFormat = tPixelFormat::R32G32B32A32F;
+			return true;
+		}
+
+		bool alpha = (flags & flagAlphaPixels) != 0;
+		uint32 alphaMask = GetLE32(b + 104);
+		switch (GetLE32(b + 88))
+		{
+			case 32:	header.PixelFormat = tPixelFormat::B8G8R8A8;	break;
+			case 24:	header.PixelFormat = tPixelFormat::B8G8R8;		break;
+			case 16:
+				if (alpha && (alphaMask == 0x8000))
+					header.PixelFormat = tPixelFormat::G3B5A1R5G2;
+				else if (alpha && (alphaMask == 0xF000))
+					header.PixelFormat = tPixelFormat::G4B4A4R4;
+				else
+					header.PixelFormat = tPixelFormat::G3B5R5G3;
+				break;
+		}
+		return true;
+	}
+
+
+	bool ProbeHDR(ImageHeader& header, HeaderReader& reader)
+	{
+		// The text header ends with a blank line. The resolution string follows, usually "-Y height +X width".
+		const char* text = (const char*)reader.GetBlock();
+		int size = reader.GetBlockSize();
+		int pos = 0;
+		while ((pos + 1 < size) && !((text[pos] == '\n') && (text[pos+1] == '\n')))
+			pos++;
+		pos += 2;
+		if (pos >= size)
+			return false;
+
+		char line[64];
+		int len = 0;
+		while ((pos < size) && (text[pos] != '\n') && (len < int(sizeof(line)) - 1))
+			line[len++] = text[pos++];
+		line[len] = '\0';
+
+		char axis0Sign, axis0, axis1Sign, axis1;
+		int size0 = 0, size1 = 0;
+		if (sscanf(line, "%c%c %d %c%c %d", &axis0Sign, &axis0, &size0, &axis1Sign, &axis1, &size1) != 6)
+			return false;
+
+		header.Width = (axis0 == 'X') ? size0 : size1;
+		header.Height = (axis0 == 'X') ? size1 : size0;
+		header.PixelFormat = tPixelFormat::RADIANCE;
+		return true;
+	}
+
+
+	bool ProbeEXR(ImageHeader& header, HeaderReader& reader)
+	{
+		// After the magic and version the header is a list of (name, type, size, value) attributes ending in an empty
+		// name. We only need dataWindow, a box of 4 ints. Long channel lists can push it past the first block.
+		const int maxAttributes = 128;
+		const int maxNameLength = 256;
+		int64 offset = 8;
+		for (int a = 0; a < maxAttributes; a++)
+		{
+			char name[maxNameLength];
+			int nameLength = reader.ReadSome(offset, (uint8*)name, maxNameLength);
+			int nameEnd = 0;
+			while ((nameEnd < nameLength) && name[nameEnd])
+				nameEnd++;
+			if ((nameEnd == 0) || (nameEnd == nameLength))
+				return false;
+
+			// Skip the type name.
+			offset += nameEnd + 1;
+			char type[maxNameLength];
+			int typeLength = reader.ReadSome(offset, (uint8*)type, maxNameLength);
+			int typeEnd = 0;
+			while ((typeEnd < typeLength) && type[typeEnd])
+				typeEnd++;
+			if (typeEnd == typeLength)
+				return false;
+			offset += typeEnd + 1;
+
+			uint8 sizeBytes[4];
+			if (!reader.Read(offset, sizeBytes, 4))
+				return false;
+			offset += 4;
+			int attribSize = int(GetLE32(sizeBytes));
+
+			if ((tStrcmp(name, "dataWindow") == 0) && (attribSize == 16))
+			{
+				uint8 box[16];
+				if (!reader.Read(offset, box, 16))
+					return false;
+				header.Width = int(GetLE32(box + 8)) - int(GetLE32(box + 0)) + 1;
+				header.Height = int(GetLE32(box + 12)) - int(GetLE32(box + 4)) + 1;
+				header.PixelFormat = tPixelFormat::OPENEXR;
+				return true;
+			}
+			offset += attribSize;
+		}
+		return false;
+	}
+
+
+	bool ProbeICO(ImageHeader& header, HeaderReader& reader)
+	{
+		const uint8* b = reader.GetBlock();
+		const int entrySize = 16;
+		int numEntries = tMath::tMin(int(GetLE16(b + 4)), (reader.GetBlockSize() - 6) / entrySize);
+		for (int e = 0; e < numEntries; e++)
+		{
+			// A zero size byte means 256. Png compressed parts may leave the bit count zero.
+			const uint8* entry = b + 6 + e*entrySize;
+			int w = entry[0] ? int(entry[0]) : 256;
+			int h = entry[1] ? int(entry[1]) : 256;
+			if (w*h <= header.Width*header.Height)
+				continue;
+
+			header.Width = w;
+			header.Height = h;
+			switch (GetLE16(entry + 6))
+			{
+				case 24:	header.PixelFormat = tPixelFormat::R8G8B8;		break;
+				case 1:
+				case 4:
+				case 8:		header.PixelFormat = tPixelFormat::PAL8BIT;		break;
+				default:	header.PixelFormat = tPixelFormat::R8G8B8A8;	break;
+			}
+		}
+		return header.IsValid();
+	}
+}
+
+
+bool ProbeImageHeader(ImageHeader& header, const tString& filename)
+{
+	header = ImageHeader();
+	FILE* file = fopen(filename.Chars(), "rb");
+	if (!file)
+		return false;
+
+	HeaderReader reader(file);
+	const uint8* b = reader.GetBlock();
+	int size = reader.GetBlockSize();
+	auto matches = [b, size](int offset, const char* sig, int len) { return (offset + len <= size) && (tMemcmp(b + offset, sig, len) == 0); };
+
+	bool ok = false;
+	if (matches(0, "\x89PNG", 4))
+		ok = ProbePNG(header, reader);
+	else if (matches(0, "\xFF\xD8", 2))
+		ok = ProbeJPG(header, reader);
+	else if (matches(0, "GIF8", 4))
+		ok = ProbeGIF(header, reader);
+	else if (matches(0, "RIFF", 4) && matches(8, "WEBP", 4))
+		ok = ProbeWEBP(header, reader);
+	else if (matches(0, "II*\0", 4) || matches(0, "MM\0*", 4))
+		ok = ProbeTIF(header, reader);
+	else if (matches(0, "DDS ", 4))
+		ok = ProbeDDS(header, reader);
+	else if (matches(0, "#?", 2))
+		ok = ProbeHDR(header, reader);
+	else if (matches(0, "\x76\x2F\x31\x01", 4))
+		ok = ProbeEXR(header, reader);
+	else if (matches(0, "BM", 2))
+		ok = ProbeBMP(header, reader);
+	else if (matches(0, "\0\0\1\0", 4))
+		ok = ProbeICO(header, reader);
+	else if (tSystem::tGetFileType(filename) == tSystem::tFileType::TGA)
+		ok = ProbeTGA(header, reader);
+
+	fclose(file);
+	if (!ok || !header.IsValid())
+	{
+		header = ImageHeader();
+		return false;
+	}
+	return true;
+}
+
+
+void HeaderProber::Probe(Result& result, const tStringItem& file)
+{
+	result.Filename = file;
+	ProbeImageHeader(result.Header, file);
+}
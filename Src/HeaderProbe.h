@@ -0,0 +1,78 @@
+// HeaderProbe.h
+//
+// Reads just the header of an image file to find its dimensions and pixel format without decoding it. A background
+// prober runs this over a whole folder.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+#include <Image/tPixelFormat.h>
+#include "BackgroundQueue.h"
+
+
+// The pixel format is the closest match to what a full load reports as the source format. For multi-part files
+// (ico) the dimensions are those of the largest part.
+struct ImageHeader
+{
+	bool IsValid() const																								{ return (Width > 0) && (Height > 0); }
+
+	// Decoded pictures are always 32 bit so this is what a load will cost in main memory, not counting extra parts.
+	int64 GetForecastMemSizeBytes() const																				{ return int64(Width) * int64(Height) * 4; }
+
+	int Width							= 0;
+	int Height							= 0;
+	tImage::tPixelFormat PixelFormat	= tImage::tPixelFormat::Invalid;
+
+	// Seconds since 1970 from the exif date of jpg and tif files, taken as if it were UTC. Zero if there isn't one.
+	int64 CaptureTime					= 0;
+};
+
+
+// Identifies the file type from its signature, not its extension. Tga has no signature so it is only tried when the
+// extension says tga. Only the first HeaderProber::HeaderBlockSize bytes are read, plus a few small seeks for jpg, tif
+// and exr where the needed data may be further in. Returns false and leaves header invalid if the format isn't known.
+bool ProbeImageHeader(ImageHeader& header, const tString& filename);
+
+
+// Probes queued files on the worker threads of a background queue. It never blocks the main thread and cancelling just
+// abandons the workers, which exit once they notice.
+class HeaderProber
+{
+public:
+	HeaderProber()																										: Queue(MaxWorkers, Probe) { }
+
+	struct Result : public tLink<Result>
+	{
+		tString Filename;
+		ImageHeader Header;				// Invalid if the probe failed.
+	};
+
+	// Moves the files out of the list and onto the queue. Workers are started as needed.
+	void Add(tList<tStringItem>& files)																					{ Queue.Add(files); }
+	void Cancel()																										{ Queue.Cancel(); }
+
+	// Moves up to maxResults results into results. Returns true once nothing is queued, being probed, or waiting to be
+	// taken, after which IsActive returns false until more files are added.
+	bool TakeResults(tList<Result>& results, int maxResults)															{ return Queue.TakeResults(results, maxResults); }
+	bool IsActive() const																								{ return Queue.IsActive(); }
+
+	const static int HeaderBlockSize;	// = 4096;
+	const static int MaxWorkers;		// = 4;
+
+private:
+	HeaderProber(const HeaderProber&) = delete;
+	HeaderProber& operator=(const HeaderProber&) = delete;
+
+	static void Probe(Result&, const tStringItem& file);
+	BackgroundQueue<tStringItem, Result> Queue;
+};
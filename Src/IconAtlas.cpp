@@ -0,0 +1,299 @@
+// IconAtlas.cpp
+//
+// All the UI icons packed into a single texture. The packed atlas is cached on disk so startup only needs one read.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <glad/glad.h>
+#include <Math/tFundamentals.h>
+#include <System/tFile.h>
+#include "IconAtlas.h"
+using namespace tMath;
+using namespace tSystem;
+using namespace tImage;
+
+
+namespace
+{
+	// Layout of the cache file. The header is followed by a rect per icon and then the atlas pixels.
+	struct CacheHeader
+	{
+		uint32 Magic;
+		tuint256 Key;
+		int32 Width;
+		int32 Height;
+		int32 NumIcons;
+	};
+	struct CacheRect
+	{
+		int32 X, Y, W, H;
+	};
+	const uint32 CacheMagic = 0x41494354;		// 'TCIA' little-endian.
+}
+
+
+uint64 Icon::Bind() const
+{
+	if (!Atlas)
+		return 0;
+
+	return Atlas->Bind();
+}
+
+
+tVector2 Icon::GetUV0(bool flipV) const
+{
+	if (!Atlas || !Atlas->GetWidth() || !Atlas->GetHeight())
+		return tVector2::zero;
+
+	float w = float(Atlas->GetWidth());
+	float h = float(Atlas->GetHeight());
+	return tVector2(float(X)/w, flipV ? float(Y)/h : float(Y+H)/h);
+}
+
+
+tVector2 Icon::GetUV1(bool flipV) const
+{
+	if (!Atlas || !Atlas->GetWidth() || !Atlas->GetHeight())
+		return tVector2::zero;
+
+	float w = float(Atlas->GetWidth());
+	float h = float(Atlas->GetHeight());
+	return tVector2(float(X+W)/w, flipV ? float(Y+H)/h : float(Y)/h);
+}
+
+
+tuint256 IconAtlas::ComputeKey(const Entry* entries, int numEntries, const tString& dataDir) const
+{
+	// Stat-ing the pngs is much cheaper than decoding them. If any of them change the atlas is rebuilt.
+	int atlasVersion = 1;
+	tuint256 key = tHashData256((uint8*)&atlasVersion, sizeof(atlasVersion));
+	key = tHashData256((uint8*)&AtlasWidth, sizeof(AtlasWidth), key);
+	key = tHashData256((uint8*)&Padding, sizeof(Padding), key);
+	for (int e = 0; e < numEntries; e++)
+	{
+		tFileInfo fileInfo;
+		tGetFileInfo(fileInfo, dataDir + entries[e].Filename);
+		key = tHashString256(entries[e].Filename, key);
+		key = tHashData256((uint8*)&fileInfo.FileSize, sizeof(fileInfo.FileSize), key);
+		key = tHashData256((uint8*)&fileInfo.ModificationTime, sizeof(fileInfo.ModificationTime), key);
+	}
+
+	return key;
+}
+
+
+bool IconAtlas::Load(const Entry* entries, int numEntries, const tString& dataDir, const tString& cacheFile)
+{
+	Unload();
+	tuint256 key = ComputeKey(entries, numEntries, dataDir);
+	if (LoadCache(entries, numEntries, cacheFile, key))
+		return true;
+
+	if (!Pack(entries, numEntries, dataDir))
+		return false;
+
+	SaveCache(entries, numEntries, cacheFile, key);
+	return true;
+}
+
+
+void IconAtlas::Unload()
+{
+	if (TexID != 0)
+	{
+		glDeleteTextures(1, &TexID);
+		TexID = 0;
+	}
+	Picture.Clear();
+	Width = 0;
+	Height = 0;
+}
+
+
+bool IconAtlas::LoadCache(const Entry* entries, int numEntries, const tString& cacheFile, const tuint256& key)
+{
+	if (!tFileExists(cacheFile))
+		return false;
+
+	int fileSize = 0;
+	uint8* data = tLoadFile(cacheFile, nullptr, &fileSize);
+	if (!data)
+		return false;
+
+	bool ok = false;
+	const CacheHeader* header = (const CacheHeader*)data;
+	if
+	(
+		(fileSize >= int(sizeof(CacheHeader))) && (header->Magic == CacheMagic) && (header->Key == key) &&
+		(header->NumIcons == numEntries) && (header->Width > 0) && (header->Height > 0)
+	)
+	{
+		int rectsSize = numEntries * sizeof(CacheRect);
+		int pixelsSize = header->Width * header->Height * sizeof(tPixel);
+		if (fileSize == int(sizeof(CacheHeader)) + rectsSize + pixelsSize)
+		{
+			const CacheRect* rects = (const CacheRect*)(data + sizeof(CacheHeader));
+			for (int e = 0; e < numEntries; e++)
+			{
+				Icon& icon = *entries[e].Dest;
+				icon.Atlas = this;
+				icon.X = rects[e].X;	icon.Y = rects[e].Y;
+				icon.W = rects[e].W;	icon.H = rects[e].H;
+			}
+
+			Width = header->Width;
+			Height = header->Height;
+			tPixel* pixels = (tPixel*)(data + sizeof(CacheHeader) + rectsSize);
+			Picture.Set(Width, Height, pixels, true);
+			ok = true;
+		}
+	}
+
+	delete[] data;
+	return ok;
+}
+
+
+void IconAtlas::SaveCache(const Entry* entries, int numEntries, const tString& cacheFile, const tuint256& key) const
+{
+	int rectsSize = numEntries * sizeof(CacheRect);
+	int pixelsSize = Width * Height * sizeof(tPixel);
+	int fileSize = sizeof(CacheHeader) + rectsSize + pixelsSize;
+	uint8* data = new uint8[fileSize];
+
+	CacheHeader* header = (CacheHeader*)data;
+	header->Magic = CacheMagic;
+	header->Key = key;
+	header->Width = Width;
+	header->Height = Height;
+	header->NumIcons = numEntries;
+
+	CacheRect* rects = (CacheRect*)(data + sizeof(CacheHeader));
+	for (int e = 0; e < numEntries; e++)
+	{
+		const Icon& icon = *entries[e].Dest;
+		rects[e].X = icon.X;	rects[e].Y = icon.Y;
+		rects[e].W = icon.W;	rects[e].H = icon.H;
+	}
+	tMemcpy(data + sizeof(CacheHeader) + rectsSize, Picture.GetPixelPointer(), pixelsSize);
+
+	if (!tCreateFile(cacheFile, data, fileSize))
+		tPrintf("Warning: Unable to write icon atlas cache %s\n", cacheFile.Chars());
+	delete[] data;
+}
+
+
+bool IconAtlas::Pack(const Entry* entries, int numEntries, const tString& dataDir)
+{
+	tPicture* pictures = new tPicture[numEntries];
+	bool ok = true;
+	for (int e = 0; e < numEntries; e++)
+	{
+		tString filename = dataDir + entries[e].Filename;
+		if (!pictures[e].Load(filename) || (pictures[e].GetWidth() + 2*Padding > AtlasWidth))
+		{
+			tPrintf("Warning: Unable to load icon %s\n", filename.Chars());
+			ok = false;
+		}
+	}
+
+	if (!ok)
+	{
+		delete[] pictures;
+		return false;
+	}
+
+	// Simple shelf packing. Placing the tallest icons first keeps the shelves tight.
+	int* order = new int[numEntries];
+	for (int e = 0; e < numEntries; e++)
+		order[e] = e;
+	for (int i = 1; i < numEntries; i++)
+	{
+		int curr = order[i];
+		int j = i - 1;
+		for (; (j >= 0) && (pictures[order[j]].GetHeight() < pictures[curr].GetHeight()); j--)
+			order[j+1] = order[j];
+		order[j+1] = curr;
+	}
+
+	int shelfX = 0;
+	int shelfY = 0;
+	int shelfH = 0;
+	for (int i = 0; i < numEntries; i++)
+	{
+		int e = order[i];
+		int w = pictures[e].GetWidth() + 2*Padding;
+		int h = pictures[e].GetHeight() + 2*Padding;
+		if (shelfX + w > AtlasWidth)
+		{
+			shelfY += shelfH;
+			shelfX = 0;
+			shelfH = 0;
+		}
+
+		Icon& icon = *entries[e].Dest;
+		icon.Atlas = this;
+		icon.X = shelfX + Padding;
+		icon.Y = shelfY + Padding;
+		icon.W = pictures[e].GetWidth();
+		icon.H = pictures[e].GetHeight();
+
+		shelfX += w;
+		shelfH = tMax(shelfH, h);
+	}
+
+	Width = AtlasWidth;
+	Height = tNextPower2(shelfY + shelfH);
+	tPixel* pixels = new tPixel[Width*Height];
+	tMemset(pixels, 0, Width*Height*sizeof(tPixel));
+	for (int e = 0; e < numEntries; e++)
+	{
+		const Icon& icon = *entries[e].Dest;
+		const tPixel* src = pictures[e].GetPixelPointer();
+		for (int y = 0; y < icon.H; y++)
+			tMemcpy(pixels + (icon.Y + y)*Width + icon.X, src + y*icon.W, icon.W*sizeof(tPixel));
+	}
+
+	// The picture takes ownership of the pixels.
+	Picture.Set(Width, Height, pixels, false);
+	delete[] order;
+	delete[] pictures;
+	return true;
+}
+
+
+uint64 IconAtlas::Bind()
+{
+	if (TexID != 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, TexID);
+		return TexID;
+	}
+
+	if (!Picture.IsValid())
+		return 0;
+
+	glGenTextures(1, &TexID);
+	if (TexID == 0)
+		return 0;
+
+	glBindTexture(GL_TEXTURE_2D, TexID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, Picture.GetPixelPointer());
+
+	// Once it's in VRAM there's no reason to keep the pixels around.
+	Picture.Clear();
+	return TexID;
+}
@@ -0,0 +1,78 @@
+// IconAtlas.h
+//
+// All the UI icons packed into a single texture. The packed atlas is cached on disk so startup only needs one read.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tString.h>
+#include <Math/tVector2.h>
+#include <Math/tHash.h>
+#include <Image/tPicture.h>
+class IconAtlas;
+
+
+// An icon is just a rectangle within the atlas. X and Y are the bottom-left corner since pictures are stored bottom-up.
+struct Icon
+{
+	// Binds the atlas texture and returns its ID. The texture is created the first time any icon is bound.
+	uint64 Bind() const;
+	int GetWidth() const																								{ return W; }
+	int GetHeight() const																								{ return H; }
+
+	// The uvs of the top-left and bottom-right corners, ready to pass to ImGui. By default the icon displays upright.
+	tMath::tVector2 GetUV0(bool flipV = false) const;
+	tMath::tVector2 GetUV1(bool flipV = false) const;
+
+	IconAtlas* Atlas	= nullptr;
+	int X				= 0;
+	int Y				= 0;
+	int W				= 0;
+	int H				= 0;
+};
+
+
+class IconAtlas
+{
+public:
+	IconAtlas()																											{ }
+
+	struct Entry
+	{
+		Icon* Dest;
+		const char* Filename;
+	};
+
+	// Loads every entry into a single atlas. If the cache file is up to date with the pngs in the data dir it is read
+	// in one go. Otherwise the pngs are loaded, packed, and the cache file is rewritten. Returns false if any icon
+	// could not be loaded. No GL calls are made here.
+	bool Load(const Entry* entries, int numEntries, const tString& dataDir, const tString& cacheFile);
+	void Unload();
+
+	uint64 Bind();
+	int GetWidth() const																								{ return Width; }
+	int GetHeight() const																								{ return Height; }
+
+	const static int AtlasWidth			= 512;
+	const static int Padding			= 2;
+
+private:
+	tuint256 ComputeKey(const Entry* entries, int numEntries, const tString& dataDir) const;
+	bool LoadCache(const Entry* entries, int numEntries, const tString& cacheFile, const tuint256& key);
+	void SaveCache(const Entry* entries, int numEntries, const tString& cacheFile, const tuint256& key) const;
+	bool Pack(const Entry* entries, int numEntries, const tString& dataDir);
+
+	// Only valid until the texture is created.
+	tImage::tPicture Picture;
+	int Width							= 0;
+	int Height							= 0;
+	uint TexID							= 0;
+};
@@ -14,6 +14,8 @@
 
 #include <mutex>
 #include <chrono>
+#include <vector>
+#include <algorithm>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>				// Include glfw3.h after our OpenGL definitions.
 #include <Math/tHash.h>
@@ -25,22 +27,59 @@
 #include <System/tFile.h>
 #include <System/tTime.h>
 #include <System/tMachine.h>
-#include <System/tChunk.h>
 #include "Image.h"
 #include "Settings.h"
+#include "Profiler.h"
+#include "GifFrame.h"
+#include "ContentHash.h"
+#include "DecodeShare.h"
+#include "ThumbnailCodec.h"
+#include "ThumbnailScaler.h"
 using namespace tStd;
 using namespace tSystem;
 using namespace tImage;
 using namespace tMath;
 using namespace Viewer;
 int Image::ThumbnailNumThreadsRunning = 0;
+int Image::MaxTextureSize = 0;
+namespace
+{
+	// Images whose thumbnail worker hasn't been joined yet. There are never more than the max thread count of them so
+	// finding one is cheap. Only touched from the main thread, and only for images that started a worker. Images made
+	// and destroyed on worker threads, like the thumbnail loader, never get here.
+	std::vector<Image*> ThumbnailWorkerImages;
+
+	// Images that hold a thumbnail picture, each knowing its own index for quick removal.
+	std::vector<Image*> ThumbnailHolders;
+
+	// Thumbnail files are copied byte for byte. Returns the number of bytes written or 0 on failure.
+	int CopyThumbnailFile(const tString& destFile, const tString& srcFile)
+	{
+		int numBytes = 0;
+		uint8* data = tFileExists(srcFile) ? tLoadFile(srcFile, nullptr, &numBytes) : nullptr;
+		bool ok = data && (numBytes > 0) && tCreateFile(destFile, data, numBytes);
+		delete[] data;
+		return ok ? numBytes : 0;
+	}
+}
+
+
+uint64 Image::ThumbnailFrame = 1;
+int64 Image::ThumbnailPicturesBytes = 0;
+int Image::ThumbnailDrawnCount = 0;
+int64 Image::ThumbnailDrawnBytes = 0;
+const int Image::ThumbnailTrimPercent = 90;
 tString Image::ThumbCacheDir;
+ThumbnailAtlas Image::ThumbAtlas;
+ThumbnailCache Image::ThumbCache;
 namespace Viewer { extern Settings Config; }
 
 
 const int Image::ThumbWidth			= 256;
 const int Image::ThumbHeight		= 144;
 const int Image::ThumbMinDispWidth	= 64;
+const int Image::ThumbStdLevel		= 2;
+const int Image::MaxTileSize		= 4096;
 
 
 Image::Image() :
@@ -54,7 +93,7 @@ Image::Image() :
 }
 
 
-Image::Image(const tString& filename) :
+Image::Image(const tString& filename, bool getFileInfo) :
 	Filename(filename),
 	Filetype(tGetFileType(filename)),
 	FileSizeB(0),
@@ -63,10 +102,11 @@ Image::Image(const tString& filename) :
 	tMemset(&FileModTime, 0, sizeof(FileModTime));
 	ResetLoadParams();
 	tSystem::tFileInfo info;
-	if (tSystem::tGetFileInfo(info, filename))
+	if (getFileInfo && tSystem::tGetFileInfo(info, filename))
 	{
 		FileModTime = info.ModificationTime;
 		FileSizeB = info.FileSize;
+		FileInfoValid = true;
 	}
 }
 
@@ -77,6 +117,12 @@ Image::~Image()
 	// accesses the thumbnail picture of this object... so 'this' must be valid.
 	if (ThumbnailThread.joinable())
 		ThumbnailThread.join();
+	if (ThumbnailThreadRunning)
+	{
+		auto worker = std::find(ThumbnailWorkerImages.begin(), ThumbnailWorkerImages.end(), this);
+		if (worker != ThumbnailWorkerImages.end())
+			ThumbnailWorkerImages.erase(worker);
+	}
 
 	// It is important that the thread count decrements if necessary since Images can be deleted
 	// when changing folders. The threads need to be available to do more work in a new folder.
@@ -86,8 +132,10 @@ Image::~Image()
 		tiClampMin(ThumbnailNumThreadsRunning, 0);
 	}
 
-	// Free GPU image mem and texture IDs.
+	// Free GPU image mem and texture IDs. The atlas slot is just returned to the pool.
 	Unload(true);
+	ReleaseThumbnailPicture();
+	ThumbAtlas.Free(ThumbnailSlot);
 }
 
 
@@ -98,7 +146,7 @@ void Image::ResetLoadParams()
 }
 
 
-bool Image::Load(const tString& filename)
+bool Image::Load(const tString& filename, bool primaryOnly)
 {
 	if (filename.IsEmpty())
 		return false;
@@ -110,23 +158,29 @@ bool Image::Load(const tString& filename)
 	{
 		FileModTime = info.ModificationTime;
 		FileSizeB = info.FileSize;
+		FileInfoValid = true;
 	}
 
-	return Load();
+	return Load(primaryOnly);
 }
 
 
-bool Image::Load()
+bool Image::Load(bool primaryOnly)
 {
 	if (IsLoaded() && !Dirty)
 	{
-		LoadedTime = tSystem::tGetTime();
-		return true;
+		if (!LoadedPrimaryOnly || primaryOnly)
+		{
+			LoadedTime = tSystem::tGetTime();
+			return true;
+		}
+		Unload();
 	}
 
 	if (Filetype == tFileType::Unknown)
 		return false;
 
+	Profiler::ScopedTimer timer(Profiler::Metric::Decode);
 	Info.SrcPixelFormat = tPixelFormat::Invalid;
 	bool success = false;
 	try
@@ -144,6 +198,20 @@ bool Image::Load()
 				Info.SrcPixelFormat = DDSTexture2D.GetPixelFormat();
 			}
 		}
+		else if ((Filetype == tSystem::tFileType::GIF) && primaryOnly)
+		{
+			// The full gif loader decodes every frame before returning. For a long animation that's most of the cost of
+			// a thumbnail, so we decode the first frame ourselves and stop reading there.
+			tPicture* picture = new tPicture();
+			success = LoadGifFirstFrame(*picture, Filename);
+			if (!success)
+			{
+				delete picture;
+				return false;
+			}
+			Pictures.Append(picture);
+			Info.SrcPixelFormat = tPixelFormat::PAL8BIT;
+		}
 		else if (Filetype == tSystem::tFileType::GIF)
 		{
 			tImageGIF gif;
@@ -196,7 +264,7 @@ bool Image::Load()
 				return false;
 
 			Info.SrcPixelFormat = ico.GetBestSrcPixelFormat();
-			int numParts = ico.GetNumParts();
+			int numParts = primaryOnly ? tMin(ico.GetNumParts(), 1) : ico.GetNumParts();
 			for (int p = 0; p < numParts; p++)
 			{
 				tImageICO::Part* part = ico.StealPart(0);
@@ -213,18 +281,36 @@ bool Image::Load()
 		else
 		{
 			// Some image files (like tiff and exr files) may store multiple images in one file. These are called 'parts'.
+			// The first part is shared with the thumbnail workers. A thumbnail decode of an image likely to be opened next
+			// keeps it for a while, and a decode already running for either is waited on rather than repeated.
 			int partNum = 0;
 			bool ok = false;
 			do
 			{
 				tPicture* picture = new tPicture();
-				ok = picture->Load(Filename, partNum, LoadParams);
+				if (partNum == 0)
+				{
+					ok = DecodeShare::Acquire
+					(
+						*picture, GetDecodeKey(),
+						[this](tPicture& decoded) { return decoded.Load(Filename, 0, LoadParams); },
+						KeepDecode
+					);
+				}
+				else
+				{
+					ok = picture->Load(Filename, partNum, LoadParams);
+				}
 				if (ok)
 				{
 					Pictures.Append(picture);
 					partNum++;
 				}
-			} while (ok);
+				else
+				{
+					delete picture;
+				}
+			} while (ok && !primaryOnly);
 
 			if (Pictures.NumItems() > 0)
 			{
@@ -250,6 +336,7 @@ bool Image::Load()
 	}
 
 	LoadedTime = tSystem::tGetTime();
+	LoadedPrimaryOnly = primaryOnly;
 
 	// Fill in rest of info struct.
 	Info.Opaque				= IsOpaque();
@@ -388,6 +475,8 @@ void Image::Unbind()
 			pic->TextureID = 0;
 		}
 	}
+	NumResidentParts = 0;
+	FreeTiles();
 
 	if (TexIDAlt != 0)
 	{
@@ -529,36 +618,234 @@ uint64 Image::Bind()
 	}
 
 	tPicture* currPic = GetCurrentPic();
-	if (currPic && (currPic->TextureID != 0))
+	if (!currPic || !currPic->IsValid())
+		return 0;
+
+	// Oversized pictures never go in the resident parts pool. They get their own tile grid instead.
+	int maxSize = GetMaxTextureSize();
+	if ((currPic->GetWidth() > maxSize) || (currPic->GetHeight() > maxSize))
+	{
+		if (TiledPic != currPic)
+		{
+			FreeTiles();
+			TiledPic = currPic;
+			TileSize = tMin(maxSize, MaxTileSize);
+			NumTilesX = (currPic->GetWidth() + TileSize - 1) / TileSize;
+			NumTilesY = (currPic->GetHeight() + TileSize - 1) / TileSize;
+			TileTexIDs = new uint[NumTilesX*NumTilesY];
+			tMemset(TileTexIDs, 0, NumTilesX*NumTilesY*sizeof(uint));
+		}
+		return BindTile(0, 0);
+	}
+
+	if (currPic->TextureID != 0)
 	{
+		TouchResidentPart(currPic);
 		glBindTexture(GL_TEXTURE_2D, currPic->TextureID);
 		return currPic->TextureID;
 	}
 
-	if (!IsLoaded())
+	// Only the current part gets uploaded. If the pool is full we take over the texture of the least recently
+	// used part rather than deleting it and generating a new one.
+	uint texID = 0;
+	if (NumResidentParts >= MaxResidentParts)
+	{
+		tPicture* lruPic = ResidentParts[0];
+		texID = lruPic->TextureID;
+		lruPic->TextureID = 0;
+		for (int r = 1; r < NumResidentParts; r++)
+			ResidentParts[r-1] = ResidentParts[r];
+		NumResidentParts--;
+	}
+
+	if (texID == 0)
+		glGenTextures(1, &texID);
+	if (texID == 0)
 		return 0;
 
-	for (tPicture* pic = Pictures.First(); pic; pic = pic->Next())
-		glGenTextures(1, &pic->TextureID);
+	currPic->TextureID = texID;
+	ResidentParts[NumResidentParts++] = currPic;
 
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
+	tList<tLayer> layers;
+	layers.Append
+	(
+		new tLayer
+		(
+			tPixelFormat::R8G8B8A8, currPic->GetWidth(), currPic->GetHeight(),
+			(uint8*)currPic->GetPixelPointer()
+		)
+	);
+
+	BindLayers(layers, currPic->TextureID);
+	return currPic->TextureID;
+}
+
+
+int Image::GetMaxTextureSize()
+{
+	if (MaxTextureSize == 0)
+	{
+		GLint maxSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+		// The spec guarantees at least 64. Some drivers report 0 if there is no context yet, so don't cache that.
+		if (maxSize <= 0)
+			return 64;
+		MaxTextureSize = maxSize;
+	}
+
+	return MaxTextureSize;
+}
+
+
+bool Image::IsTiled() const
+{
+	if (AltPictureEnabled && AltPicture.IsValid())
+		return false;
+
+	return TiledPic && (TiledPic == GetCurrentPic());
+}
+
+
+void Image::FreeTiles()
+{
+	if (TileTexIDs)
 	{
-		if (picture && picture->IsValid())
+		for (int t = 0; t < NumTilesX*NumTilesY; t++)
+			if (TileTexIDs[t] != 0)
+				glDeleteTextures(1, &TileTexIDs[t]);
+		delete[] TileTexIDs;
+	}
+
+	TileTexIDs = nullptr;
+	TiledPic = nullptr;
+	TileSize = 0;
+	NumTilesX = 0;
+	NumTilesY = 0;
+}
+
+
+uint Image::BindTile(int tileX, int tileY)
+{
+	uint& texID = TileTexIDs[tileY*NumTilesX + tileX];
+	if (texID != 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, texID);
+		return texID;
+	}
+
+	glGenTextures(1, &texID);
+	if (texID == 0)
+		return 0;
+
+	Profiler::ScopedTimer timer(Profiler::Metric::GPUUpload);
+
+	// The tile is a sub-rect of the picture so we let GL skip to it rather than copying the pixels out first. Edge
+	// tiles may be smaller than TileSize.
+	int picW = TiledPic->GetWidth();
+	int picH = TiledPic->GetHeight();
+	int x = tileX*TileSize;
+	int y = tileY*TileSize;
+	int w = tMin(TileSize, picW - x);
+	int h = tMin(TileSize, picH - y);
+
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, picW);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, TiledPic->GetPixelPointer());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	return texID;
+}
+
+
+void Image::DrawQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1)
+{
+	if (!IsTiled())
+	{
+		glBegin(GL_QUADS);
+		glTexCoord2f(u0, v0); glVertex2f(x0, y0);
+		glTexCoord2f(u0, v1); glVertex2f(x0, y1);
+		glTexCoord2f(u1, v1); glVertex2f(x1, y1);
+		glTexCoord2f(u1, v0); glVertex2f(x1, y0);
+		glEnd();
+		return;
+	}
+
+	if ((u1 <= u0) || (v1 <= v0))
+		return;
+
+	// We can't rely on GL_REPEAT across tiles so every repeat of the image that overlaps the uv range is walked
+	// explicitly. Each tile is clipped to the range so tiles that are not visible are never bound or uploaded.
+	float picW = float(TiledPic->GetWidth());
+	float picH = float(TiledPic->GetHeight());
+	float xPerU = (x1 - x0) / (u1 - u0);
+	float yPerV = (y1 - y0) / (v1 - v0);
+	for (int repV = int(tFloor(v0)); float(repV) < v1; repV++)
+	{
+		for (int repU = int(tFloor(u0)); float(repU) < u1; repU++)
 		{
-			tList<tLayer> layers;
-			layers.Append
-			(
-				new tLayer
-				(
-					tPixelFormat::R8G8B8A8, picture->GetWidth(), picture->GetHeight(),
-					(uint8*)picture->GetPixelPointer()
-				)
-			);
-
-			BindLayers(layers, picture->TextureID);
+			for (int ty = 0; ty < NumTilesY; ty++)
+			{
+				float tileV0 = float(repV) + float(ty*TileSize) / picH;
+				float tileV1 = float(repV) + float(tMin((ty+1)*TileSize, TiledPic->GetHeight())) / picH;
+				float clipV0 = tMax(tileV0, v0);
+				float clipV1 = tMin(tileV1, v1);
+				if (clipV1 <= clipV0)
+					continue;
+
+				for (int tx = 0; tx < NumTilesX; tx++)
+				{
+					float tileU0 = float(repU) + float(tx*TileSize) / picW;
+					float tileU1 = float(repU) + float(tMin((tx+1)*TileSize, TiledPic->GetWidth())) / picW;
+					float clipU0 = tMax(tileU0, u0);
+					float clipU1 = tMin(tileU1, u1);
+					if (clipU1 <= clipU0)
+						continue;
+
+					if (!BindTile(tx, ty))
+						continue;
+
+					// Screen position comes from the full quad mapping. Texture coords are relative to the tile.
+					float sx0 = x0 + (clipU0 - u0)*xPerU;		float sx1 = x0 + (clipU1 - u0)*xPerU;
+					float sy0 = y0 + (clipV0 - v0)*yPerV;		float sy1 = y0 + (clipV1 - v0)*yPerV;
+					float tu0 = (clipU0 - tileU0) / (tileU1 - tileU0);
+					float tu1 = (clipU1 - tileU0) / (tileU1 - tileU0);
+					float tv0 = (clipV0 - tileV0) / (tileV1 - tileV0);
+					float tv1 = (clipV1 - tileV0) / (tileV1 - tileV0);
+
+					glBegin(GL_QUADS);
+					glTexCoord2f(tu0, tv0); glVertex2f(sx0, sy0);
+					glTexCoord2f(tu0, tv1); glVertex2f(sx0, sy1);
+					glTexCoord2f(tu1, tv1); glVertex2f(sx1, sy1);
+					glTexCoord2f(tu1, tv0); glVertex2f(sx1, sy0);
+					glEnd();
+				}
+			}
 		}
 	}
-	return GetCurrentPic()->TextureID;
+}
+
+
+void Image::TouchResidentPart(tPicture* pic)
+{
+	// Move the part to the most-recently-used end. The list is tiny so a linear search is fine.
+	for (int r = 0; r < NumResidentParts; r++)
+	{
+		if (ResidentParts[r] != pic)
+			continue;
+
+		for (int m = r+1; m < NumResidentParts; m++)
+			ResidentParts[m-1] = ResidentParts[m];
+		ResidentParts[NumResidentParts-1] = pic;
+		return;
+	}
 }
 
 
@@ -567,6 +854,7 @@ void Image::BindLayers(const tList<tLayer>& layers, uint texID)
 	if (layers.IsEmpty())
 		return;
 
+	Profiler::ScopedTimer timer(Profiler::Metric::GPUUpload);
 	glBindTexture(GL_TEXTURE_2D, texID);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -768,20 +1056,16 @@ bool Image::ConvertCubemapToPicture()
 }
 
 
-uint64 Image::BindThumbnail()
+uint64 Image::BindThumbnail(tVector2& uv0, tVector2& uv1)
 {
 	if (!ThumbnailRequested)
 		return 0;
 
-	if (!ThumbnailThreadFlag.test_and_set())
-	{
-		ThumbnailThread.join();
-		ThumbnailThreadRunning = false;
-		ThumbnailNumThreadsRunning--;
-	}
+	JoinThumbnailWorker();
 
+	// While a different level is generated the previous one is still shown, provided it's still in the atlas.
 	if (ThumbnailThreadRunning)
-		return 0;
+		return ThumbAtlas.Touch(ThumbnailSlot, uv0, uv1);
 
 	// We only ever access ThumbnailPicture once the worker thread is completed,
 	// If the worker thread failed, ThumbnailPicture will be invalid and we return 0.
@@ -789,48 +1073,161 @@ uint64 Image::BindThumbnail()
 	{
 		ThumbnailRequested = false;
 		ThumbnailInvalidateRequested = false;
-		ThumbnailPicture.Clear();
-		if (TexIDThumbnail != 0)
-		{
-			glDeleteTextures(1, &TexIDThumbnail);
-			TexIDThumbnail = 0;
-		}
+		ReleaseThumbnailPicture();
+		ThumbAtlas.Free(ThumbnailSlot);
 		return 0;
 	}
 
-	if (ThumbnailPicture.IsValid())
+	// A freshly generated picture (perhaps a different level) must not be hidden by what the slot held before.
+	if (ThumbnailNeedsUpload)
 	{
-		if (TexIDThumbnail != 0)
+		if (ThumbnailPicture.IsValid())
+			ThumbAtlas.Free(ThumbnailSlot);
+		ThumbnailNeedsUpload = false;
+	}
+
+	// The slot may have been evicted by other thumbnails since we last drew. If so we just upload it again from the
+	// picture we still have in memory. If that was trimmed too, the next request reads it back from the disk cache.
+	if (!ThumbAtlas.IsResident(ThumbnailSlot))
+	{
+		if (!ThumbnailPicture.IsValid())
 		{
-			glBindTexture(GL_TEXTURE_2D, TexIDThumbnail);
-			return TexIDThumbnail;
+			if (ThumbnailDropped)
+			{
+				ThumbnailDropped = false;
+				ThumbnailRequested = false;
+			}
+			return 0;
 		}
 
-		glGenTextures(1, &TexIDThumbnail);
-		if (TexIDThumbnail == 0)
+		if (!ThumbAtlas.Alloc(ThumbnailSlot, ThumbnailPicture.GetWidth(), ThumbnailPicture.GetHeight()))
 			return 0;
+		ThumbAtlas.Upload(ThumbnailSlot, ThumbnailPicture);
+	}
+
+	MarkThumbnailDrawn();
+	return ThumbAtlas.Touch(ThumbnailSlot, uv0, uv1);
+}
 
-		tList<tLayer> layers;
-		layers.Append
-		(
-			new tLayer
-			(
-				tPixelFormat::R8G8B8A8, ThumbnailPicture.GetWidth(), ThumbnailPicture.GetHeight(),
-				(uint8*)ThumbnailPicture.GetPixelPointer()
-			)
-		);
 
-		BindLayers(layers, TexIDThumbnail);
-		return TexIDThumbnail;
+bool Image::JoinThumbnailWorker(bool wait)
+{
+	if (!ThumbnailThreadRunning || (!wait && ThumbnailThreadFlag.test_and_set()))
+		return false;
+
+	ThumbnailThread.join();
+	ThumbnailThreadRunning = false;
+	ThumbnailNumThreadsRunning--;
+	ThumbnailNeedsUpload = true;
+	HoldThumbnailPicture();
+	auto worker = std::find(ThumbnailWorkerImages.begin(), ThumbnailWorkerImages.end(), this);
+	if (worker != ThumbnailWorkerImages.end())
+	{
+		*worker = ThumbnailWorkerImages.back();
+		ThumbnailWorkerImages.pop_back();
 	}
+	return true;
+}
 
-	return 0;
+
+void Image::ReapThumbnailWorkers()
+{
+	// Joining removes the image from the list so we go backwards.
+	for (int w = int(ThumbnailWorkerImages.size()) - 1; w >= 0; w--)
+		ThumbnailWorkerImages[w]->JoinThumbnailWorker();
+}
+
+
+void Image::HoldThumbnailPicture()
+{
+	if (!ThumbnailPicture.IsValid() || (ThumbnailHolderIndex != -1))
+		return;
+
+	ThumbnailHolderIndex = int(ThumbnailHolders.size());
+	ThumbnailHolders.push_back(this);
+	ThumbnailPicturesBytes += GetThumbnailPictureBytes();
+
+	// A new picture counts as drawn so it isn't dropped before it's had a chance to be.
+	ThumbnailLastDrawn = 0;
+	MarkThumbnailDrawn();
+}
+
+
+void Image::ReleaseThumbnailPicture()
+{
+	if (ThumbnailHolderIndex != -1)
+	{
+		Image* last = ThumbnailHolders.back();
+		ThumbnailHolders[ThumbnailHolderIndex] = last;
+		last->ThumbnailHolderIndex = ThumbnailHolderIndex;
+		ThumbnailHolders.pop_back();
+		ThumbnailHolderIndex = -1;
+		ThumbnailPicturesBytes -= GetThumbnailPictureBytes();
+		if (ThumbnailLastDrawn == ThumbnailFrame)
+		{
+			ThumbnailDrawnCount--;
+			ThumbnailDrawnBytes -= GetThumbnailPictureBytes();
+		}
+	}
+	ThumbnailPicture.Clear();
+}
+
+
+void Image::MarkThumbnailDrawn()
+{
+	if ((ThumbnailLastDrawn != ThumbnailFrame) && (ThumbnailHolderIndex != -1))
+	{
+		ThumbnailDrawnCount++;
+		ThumbnailDrawnBytes += GetThumbnailPictureBytes();
+	}
+	ThumbnailLastDrawn = ThumbnailFrame;
+}
+
+
+void Image::TrimThumbnailPictures(int64 budgetBytes)
+{
+	uint64 frame = ThumbnailFrame++;
+	int numDrawn = ThumbnailDrawnCount;
+	int64 drawnBytes = ThumbnailDrawnBytes;
+	ThumbnailDrawnCount = 0;
+	ThumbnailDrawnBytes = 0;
+	if (ThumbnailPicturesBytes <= budgetBytes)
+		return;
+
+	// Pictures drawn this frame are never dropped. If that's all of them there's nothing to do, and if they alone are
+	// over budget we wait until the rest have grown to a budget's worth rather than sorting everything each frame.
+	if (int(ThumbnailHolders.size()) <= numDrawn)
+		return;
+	if ((drawnBytes > budgetBytes) && (ThumbnailPicturesBytes - drawnBytes <= budgetBytes))
+		return;
+
+	// We trim to a bit under budget so this doesn't run again every frame. Only the images over the line are sorted.
+	std::vector<Image*> holders(ThumbnailHolders);
+	int64 targetBytes = budgetBytes / 100 * ThumbnailTrimPercent;
+	int64 bytesPerPicture = tMax(ThumbnailPicturesBytes / int64(holders.size()), int64(1));
+	int numToDrop = tClamp(int((ThumbnailPicturesBytes - targetBytes) / bytesPerPicture) + 1, 1, int(holders.size()));
+	std::nth_element
+	(
+		holders.begin(), holders.begin() + (numToDrop-1), holders.end(),
+		[](const Image* a, const Image* b) { return a->ThumbnailLastDrawn < b->ThumbnailLastDrawn; }
+	);
+
+	for (int h = 0; (h < numToDrop) && (ThumbnailPicturesBytes > targetBytes); h++)
+	{
+		// The dropped range isn't in order after nth_element, so one drawn this frame doesn't mean the rest were too.
+		Image* image = holders[h];
+		if (image->ThumbnailLastDrawn >= frame)
+			continue;
+		image->ReleaseThumbnailPicture();
+		image->ThumbnailDropped = true;
+	}
 }
 
 
 void Image::GenerateThumbnailBridge(Image* img)
 {
 	img->GenerateThumbnail();
+	img->ThumbnailSource.Clear();
 }
 
 
@@ -840,103 +1237,282 @@ void Image::GenerateThumbnail()
 	if (ThumbnailPicture.IsValid())
 		return;
 
-	// Retrieve from cache if possible.
-	tuint256 hash = 0;
-	int thumbVersion = 1;
+	Profiler::ScopedTimer timer(Profiler::Metric::Thumbnail);
+
+	// Retrieve from cache if possible. Each level is a separate file so only the size being displayed is read.
 	tFileInfo fileInfo;
 	tGetFileInfo(fileInfo, Filename);
-	hash = tHashData256((uint8*)&thumbVersion, sizeof(thumbVersion));
-	hash = tHashString256(Filename, hash);
-	hash = tHashData256((uint8*)&fileInfo.FileSize, sizeof(fileInfo.FileSize), hash);
-	hash = tHashData256((uint8*)&fileInfo.CreationTime, sizeof(fileInfo.CreationTime), hash);
-	hash = tHashData256((uint8*)&fileInfo.ModificationTime, sizeof(fileInfo.ModificationTime), hash);
-	hash = tHashData256((uint8*)&ThumbWidth, sizeof(ThumbWidth), hash);
-	hash = tHashData256((uint8*)&ThumbHeight, sizeof(ThumbHeight), hash);
-	tString hashFile;
-	tsPrintf(hashFile, "%s%032|256X.bin", ThumbCacheDir.Chars(), hash);
-	if (tFileExists(hashFile))
+	tString cacheFile = GetThumbnailCacheFile(fileInfo, ThumbnailLevel);
+	if (tFileExists(cacheFile) && ThumbnailCodec::Load(ThumbnailPicture, cacheFile))
 	{
-		tChunkReader chunk(hashFile);
-		ThumbnailPicture.Load(chunk.First());
+		ThumbCache.Touch(cacheFile);
 		return;
 	}
 
-	// We need an opengl context if we are processing dds files (for now... opengl is used for decompression). GLFW doesn't support creating
-	// contexts without an associated window. However, contexts with hidden windows can be created with the GLFW_VISIBLE window hint.
-	GLFWwindow* offscreenContext = nullptr;
-	if (Filetype == tFileType::DDS)
+	// On a miss a copy of the file may still have been done already, perhaps under another name or in another
+	// folder. Hashing costs a read of the file, but a decode needs that read anyway and it will hit the OS cache.
+	uint64 contentHash = 0;
+	bool useContent = Viewer::Config.ThumbnailDedup && ContentHash::HashFile(contentHash, Filename);
+	if (useContent)
 	{
-		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
-		offscreenContext = glfwCreateWindow(32, 32, "placeholdertitle", nullptr, nullptr);
-		if (!offscreenContext)
+		tString contentFile = GetThumbnailContentFile(contentHash, fileInfo.FileSize, ThumbnailLevel);
+		if (tFileExists(contentFile) && ThumbnailCodec::Load(ThumbnailPicture, contentFile))
+		{
+			// Generation writes every level up to the top one under both keys. Copying all of them under the path key
+			// means this file won't need hashing again whatever level is shown, and WarmThumbnail's check of just the
+			// top level stays true.
+			int topLevel = tMax(ThumbnailLevel, ThumbStdLevel);
+			for (int level = 0; level <= topLevel; level++)
+			{
+				tString levelContentFile = GetThumbnailContentFile(contentHash, fileInfo.FileSize, level);
+				tString levelFile = GetThumbnailCacheFile(fileInfo, level);
+				int numBytes = CopyThumbnailFile(levelFile, levelContentFile);
+				if (numBytes <= 0)
+					continue;
+				ThumbCache.Touch(levelContentFile);
+				ThumbCache.Add(levelFile, numBytes);
+			}
 			return;
-
-		glfwMakeContextCurrent(offscreenContext);
+		}
 	}
 
+	// Thumbnails are generated from the primary (first) picture in the picture list. If the image was already loaded
+	// when the thumbnail was requested we were given a copy of it and there's nothing to decode.
 	Image thumbLoader;
-	thumbLoader.Load(Filename);
-
-	if (Filetype == tFileType::DDS)
+	tPicture* srcPic = nullptr;
+	if (ThumbnailSource.IsValid())
 	{
-		glfwMakeContextCurrent(nullptr);
-		glfwDestroyWindow(offscreenContext);
+		srcPic = &ThumbnailSource;
+	}
+	else
+	{
+		// We need an opengl context if we are processing dds files (for now... opengl is used for decompression). GLFW doesn't support creating
+		// contexts without an associated window. However, contexts with hidden windows can be created with the GLFW_VISIBLE window hint.
+		GLFWwindow* offscreenContext = nullptr;
+		if (Filetype == tFileType::DDS)
+		{
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			offscreenContext = glfwCreateWindow(32, 32, "placeholdertitle", nullptr, nullptr);
+			if (!offscreenContext)
+				return;
+
+			glfwMakeContextCurrent(offscreenContext);
+		}
+
+		thumbLoader.KeepDecode = ThumbnailKeepDecode;
+		thumbLoader.Load(Filename, true);
+
+		if (Filetype == tFileType::DDS)
+		{
+			glfwMakeContextCurrent(nullptr);
+			glfwDestroyWindow(offscreenContext);
+		}
+		srcPic = thumbLoader.GetPrimaryPic();
 	}
 
-	// Thumbnails are generated from the primary (first) picture in the picture list.
-	tPicture* srcPic = thumbLoader.GetPrimaryPic();
 	if (!srcPic)
 	{
 		tPrintf("Warning: Generation of thumbnail %s failed.\n", Filename.Chars());
 		return;
 	}
 
+	// Having paid for the decode we write every level up to the standard one, or up to the requested one if it's
+	// bigger. That way changing the thumbnail size later is just a cache read.
+	int topLevel = tMax(ThumbnailLevel, ThumbStdLevel);
+	int thumbW = GetThumbLevelWidth(topLevel);
+	int thumbH = GetThumbLevelHeight(topLevel);
+
 	// We make the thumbnail keep its aspect ratio.
 	int srcW = srcPic->GetWidth();
 	int srcH = srcPic->GetHeight();
-	float scaleX = float(ThumbWidth)  / float(srcW);
-	float scaleY = float(ThumbHeight) / float(srcH);
+	float scaleX = float(thumbW) / float(srcW);
+	float scaleY = float(thumbH) / float(srcH);
 	int iw, ih;
 	if (scaleX < scaleY)
 	{
-		iw = ThumbWidth;
+		iw = thumbW;
 		ih = int(tRound(float(srcH)*scaleX));
 	}
 	else
 	{
-		ih = ThumbHeight;
+		ih = thumbH;
 		iw = int(tRound(float(srcW)*scaleY));
 	}
-	tAssert((iw == ThumbWidth) || (ih == ThumbHeight));
+	tAssert((iw == thumbW) || (ih == thumbH));
 
 	// Create an image that is big (or small) enough to exactly match either the width or height without ruining the aspect.
-	srcPic->Resample(iw, ih, tPicture::tFilter::Bilinear);
+	// Large sources are box halved first so the slow filter only ever sees an image near the target size.
+	ThumbnailScaler::Downscale(*srcPic, iw, ih);
 
 	// Center-crop the image to what we need. Cropping to a bigger size adds transparent pixels.
-	srcPic->Crop(ThumbWidth, ThumbHeight);
+	srcPic->Crop(thumbW, thumbH);
 
-	ThumbnailPicture.Set(*srcPic);
+	// Each level below the top is exactly half the size of the one above it, which is a single box stage.
+	for (int level = topLevel; level >= 0; level--)
+	{
+		if (level < topLevel)
+			ThumbnailScaler::Downscale(*srcPic, GetThumbLevelWidth(level), GetThumbLevelHeight(level));
+		if (level == ThumbnailLevel)
+			ThumbnailPicture.Set(*srcPic);
+
+		tString levelFile = GetThumbnailCacheFile(fileInfo, level);
+		int numBytes = ThumbnailCodec::Save(levelFile, *srcPic);
+		if (numBytes > 0)
+			ThumbCache.Add(levelFile, numBytes);
 
-	// Write to cache file.
-	tChunkWriter writer(hashFile);
-	ThumbnailPicture.Save(writer);
-	// std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (useContent)
+		{
+			tString contentFile = GetThumbnailContentFile(contentHash, fileInfo.FileSize, level);
+			numBytes = ThumbnailCodec::Save(contentFile, *srcPic);
+			if (numBytes > 0)
+				ThumbCache.Add(contentFile, numBytes);
+		}
+	}
 }
 
 
-void Image::RequestThumbnail()
+Image::WarmResult Image::WarmThumbnail(int level)
 {
-	if (ThumbnailRequested)
-		return;
+	// Generation always writes every level up to the top one, so if the top one is there they all are.
+	int topLevel = tMax(level, ThumbStdLevel);
+	tFileInfo fileInfo;
+	if (!tGetFileInfo(fileInfo, Filename))
+		return WarmResult::Failed;
+	if (tFileExists(GetThumbnailCacheFile(fileInfo, topLevel)))
+		return WarmResult::Cached;
+	if (Filetype == tFileType::DDS)
+		return WarmResult::Skipped;
+
+	ThumbnailPicture.Clear();
+	ThumbnailLevel = topLevel;
+	GenerateThumbnail();
+	bool generated = ThumbnailPicture.IsValid();
+	ThumbnailPicture.Clear();
+	ThumbnailLevel = -1;
+	return generated ? WarmResult::Generated : WarmResult::Failed;
+}
+
+
+tString Image::GetThumbnailCacheFile(const tFileInfo& fileInfo, int level) const
+{
+	// Version 2 files are compressed. Older raw chunk files simply stop being found and age out of the cache.
+	int thumbVersion = 2;
+	int thumbW = GetThumbLevelWidth(level);
+	int thumbH = GetThumbLevelHeight(level);
+	tuint256 hash = 0;
+	hash = tHashData256((uint8*)&thumbVersion, sizeof(thumbVersion));
+	hash = tHashString256(Filename, hash);
+	hash = tHashData256((uint8*)&fileInfo.FileSize, sizeof(fileInfo.FileSize), hash);
+	hash = tHashData256((uint8*)&fileInfo.CreationTime, sizeof(fileInfo.CreationTime), hash);
+	hash = tHashData256((uint8*)&fileInfo.ModificationTime, sizeof(fileInfo.ModificationTime), hash);
+	hash = tHashData256((uint8*)&thumbW, sizeof(thumbW), hash);
+	hash = tHashData256((uint8*)&thumbH, sizeof(thumbH), hash);
+	tString hashFile;
+	tsPrintf(hashFile, "%s%032|256X.bin", ThumbCacheDir.Chars(), hash);
+	return hashFile;
+}
+
 
+uint64 Image::GetDecodeKey() const
+{
+	// The thumbnail loader always has the file info, so it's fetched here if this image doesn't have it yet.
+	std::time_t modTime = FileModTime;
+	uint64 fileSize = FileSizeB;
+	tFileInfo fileInfo;
+	if (!FileInfoValid && tGetFileInfo(fileInfo, Filename))
+	{
+		modTime = fileInfo.ModificationTime;
+		fileSize = fileInfo.FileSize;
+	}
+
+	uint64 key = ContentHash::HashData((const uint8*)Filename.Chars(), Filename.Length());
+	key = ContentHash::HashData((const uint8*)&modTime, sizeof(modTime), key);
+	key = ContentHash::HashData((const uint8*)&fileSize, sizeof(fileSize), key);
+	return HashLoadParams(LoadParams, key);
+}
+
+
+uint64 Image::HashLoadParams(const tPicture::LoadParams& params, uint64 seed)
+{
+	// Each member is hashed by itself so any padding in the struct doesn't matter.
+	uint64 hash = seed;
+	hash = ContentHash::HashData((const uint8*)&params.GammaValue, sizeof(params.GammaValue), hash);
+	hash = ContentHash::HashData((const uint8*)&params.HDR_Exposure, sizeof(params.HDR_Exposure), hash);
+	hash = ContentHash::HashData((const uint8*)&params.EXR_Exposure, sizeof(params.EXR_Exposure), hash);
+	hash = ContentHash::HashData((const uint8*)&params.EXR_Defog, sizeof(params.EXR_Defog), hash);
+	hash = ContentHash::HashData((const uint8*)&params.EXR_KneeLow, sizeof(params.EXR_KneeLow), hash);
+	hash = ContentHash::HashData((const uint8*)&params.EXR_KneeHigh, sizeof(params.EXR_KneeHigh), hash);
+	return hash;
+}
+
+
+tString Image::GetThumbnailContentFile(uint64 contentHash, uint64 fileSize, int level)
+{
+	// The 'C' keeps these keys apart from the path keys, which start with the version instead.
+	int thumbVersion = 2;
+	int thumbW = GetThumbLevelWidth(level);
+	int thumbH = GetThumbLevelHeight(level);
+	tuint256 hash = 0;
+	hash = tHashData256((uint8*)"C", 1);
+	hash = tHashData256((uint8*)&thumbVersion, sizeof(thumbVersion), hash);
+	hash = tHashData256((uint8*)&contentHash, sizeof(contentHash), hash);
+	hash = tHashData256((uint8*)&fileSize, sizeof(fileSize), hash);
+	hash = tHashData256((uint8*)&thumbW, sizeof(thumbW), hash);
+	hash = tHashData256((uint8*)&thumbH, sizeof(thumbH), hash);
+	tString hashFile;
+	tsPrintf(hashFile, "%s%032|256X.bin", ThumbCacheDir.Chars(), hash);
+	return hashFile;
+}
+
+
+int Image::GetThumbLevel(float pixelWidth, bool allowTopLevel)
+{
+	int maxLevel = allowTopLevel ? ThumbNumLevels-1 : ThumbNumLevels-2;
+	int level = 0;
+	while ((level < maxLevel) && (float(GetThumbLevelWidth(level)) < pixelWidth))
+		level++;
+	return level;
+}
+
+
+int Image::GetThumbnailNumThreadsMax()
+{
 	// Leave two cores free unless we are on a three core or lower machine, in which case we always use a min of 2 threads.
-	int numThreadsMax = tClampMin((tSystem::tGetNumCores()) - 2, 2);
-	if (ThumbnailNumThreadsRunning >= numThreadsMax)
+	return tClampMin((tSystem::tGetNumCores()) - 2, 2);
+}
+
+
+void Image::RequestThumbnail(int level, bool likelyNextView)
+{
+	// A new level is just a new request once any running worker is done. The old picture stays bound until then.
+	if (ThumbnailRequested && (ThumbnailThreadRunning || (level == ThumbnailLevel)))
+		return;
+
+	if (ThumbnailNumThreadsRunning >= GetThumbnailNumThreadsMax())
 		return;
 
+	ReleaseThumbnailPicture();
+	ThumbnailDropped = false;
+	ThumbnailKeepDecode = likelyNextView;
+
+	// A loaded image already has the pixels. They're only what a fresh decode would give if the image is unedited and
+	// was loaded with the same params the thumbnail loader uses. The copy is a full size one, so it's only made when
+	// the worker can't just read the thumbnail from the cache. That check is a couple of stats, far cheaper.
+	tPicture* primary = GetPrimaryPic();
+	tPicture::LoadParams defaultParams;
+	defaultParams.GammaValue = Viewer::Config.MonitorGamma;
+	if (primary && primary->IsValid() && !Dirty && (HashLoadParams(LoadParams) == HashLoadParams(defaultParams)))
+	{
+		tFileInfo fileInfo;
+		if (tGetFileInfo(fileInfo, Filename) && !tFileExists(GetThumbnailCacheFile(fileInfo, level)))
+			ThumbnailSource.Set(*primary);
+	}
+
+	ThumbnailLevel = level;
 	ThumbnailRequested = true;
 	ThumbnailThreadRunning = true;
 	ThumbnailNumThreadsRunning++;
+	ThumbnailWorkerImages.push_back(this);
 	ThumbnailThreadFlag.test_and_set();
 	ThumbnailThread = std::thread
 	(
@@ -24,6 +24,9 @@
 #include <Image/tCubemap.h>
 #include <Image/tImageHDR.h>
 #include "Settings.h"
+#include "ThumbnailAtlas.h"
+#include "ThumbnailCache.h"
+#include "HeaderProbe.h"
 
 
 class Image : public tLink<Image>
@@ -31,8 +34,10 @@ class Image : public tLink<Image>
 public:
 	Image();
 
-	// This constructor does not actually load the image, but Load() may be called at any point afterwards.
-	Image(const tString& filename);
+	// This constructor does not actually load the image, but Load() may be called at any point afterwards. If
+	// getFileInfo is false the mod time and size are left for the caller to fill in, which is much faster when adding
+	// a lot of images since the stat calls can be batched.
+	Image(const tString& filename, bool getFileInfo = true);
 	virtual ~Image();
 
 	// These params are in principle different to the ones in tPicture since a Image does not necessarily
@@ -51,8 +56,10 @@ public:
 	bool PartPlayLooping = true;
 	int PartNum = 0;
 
-	bool Load(const tString& filename);
-	bool Load();						// Load into main memory.
+	// Load into main memory. With primaryOnly set only the first frame or part is decoded, which is all a thumbnail
+	// needs. For gifs the rest of the file isn't even read. A later full load replaces a primary-only one.
+	bool Load(const tString& filename, bool primaryOnly = false);
+	bool Load(bool primaryOnly = false);
 	bool IsLoaded() const																								{ return (Pictures.Count() > 0); }
 	int GetNumParts() const																								{ return Pictures.Count(); }
 
@@ -63,9 +70,16 @@ public:
 	// Bind to a texture ID and load into VRAM. If already in VRAM, it makes the texture current. Since some ImGui
 	// functions require a texture ID as parameter, this function return the ID.
 	// If the alt image is enabled, the bound texture and ID  will be the alt image's.
+	// For multi-part images only the current part is uploaded. See MaxResidentParts.
+	// Pictures bigger than the max texture size are split into tiles. In this case the first tile is bound.
 	// Returns 0 (invalid id) if there was a problem.
 	uint64 Bind();
 	void Unbind();
+
+	// Draws a quad covering the screen rect x0,y0 to x1,y1 textured with the normalized image uv range u0,v0 to
+	// u1,v1. Uvs outside 0..1 repeat the image. Tiled pictures are drawn a quad per tile and tiles outside the uv
+	// range are skipped. Call Bind and enable GL_TEXTURE_2D first.
+	void DrawQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1);
 	int GetWidth() const;
 	int GetHeight() const;
 	tColouri GetPixel(int x, int y) const;
@@ -102,8 +116,14 @@ public:
 	// Thumbnail generation is done on a seperate thread. Calling RequestThumbnail starts the thread. You should call it
 	// over and over as it will only ever start one thread, and it may not start it if too mnay threads are already
 	// working. BindThumbnail will at some point return a non-zero texture ID, but not necessarily right away. Just keep
-	// calling it. Unloaded images remain unloaded after thumbnail generation.
-	void RequestThumbnail();
+	// calling it. Unloaded images remain unloaded after thumbnail generation. The returned texture is a page of the
+	// shared thumbnail atlas so the uvs of the thumbnail within it are returned as well.
+	//
+	// Thumbnails come in ThumbNumLevels sizes, each twice the width of the one before, starting at ThumbMinDispWidth.
+	// Requesting a different level from last time swaps the picture over once the new level is ready. Pass
+	// likelyNextView for images the user will probably open next. If the worker has to decode, its full size result
+	// is then kept (within budget) for the image load to take.
+	void RequestThumbnail(int level, bool likelyNextView = false);
 
 	// Call this if you need to invaidate the thumbnail. For example, if the file was saved/edited this should be called
 	// to force regeneration.
@@ -112,18 +132,52 @@ public:
 	// You are allowed to unrequest. It will succeed if a worker was never assigned.
 	void UnrequestThumbnail();
 	bool IsThumbnailWorkerActive() const { return ThumbnailThreadRunning; }
-	uint64 BindThumbnail();
+	uint64 BindThumbnail(tMath::tVector2& uv0, tMath::tVector2& uv1);
+	// Joins any finished thumbnail workers, drawn or not, so their threads are free for new requests. Call every frame.
+	static void ReapThumbnailWorkers();
+
+	// Blocks until any thumbnail worker of this image is done. Call before changing anything the worker reads, like
+	// Filename or Filetype. Main thread only.
+	void WaitForThumbnailWorker()																						{ JoinThumbnailWorker(true); }
+
+	// Thumbnail textures live in ThumbAtlas, which has its own fixed size. This bounds the CPU copies. When they take
+	// more than budgetBytes the least recently drawn are dropped, except any drawn this frame. A dropped thumbnail keeps
+	// drawing from the atlas while it's resident and is read back from the disk cache if it's needed again after that.
+	// Call once per frame after ReapThumbnailWorkers.
+	static void TrimThumbnailPictures(int64 budgetBytes);
+	static int64 GetThumbnailPicturesBytes()																			{ return ThumbnailPicturesBytes; }
+	static int GetThumbnailNumThreadsRunning()																			{ return ThumbnailNumThreadsRunning; }
+	static int GetThumbnailNumThreadsMax();
+
+	// Writes the thumbnail levels up to the given one (and at least up to ThumbStdLevel) into the cache on the calling
+	// thread and keeps nothing in memory. Used by the headless cache warmer. Dds files need a GL context to decode so
+	// they are skipped.
+	enum class WarmResult { Generated, Cached, Skipped, Failed };
+	WarmResult WarmThumbnail(int level);
 
 	ImgInfo Info;						// Info is only valid AFTER loading.
+	ImageHeader Header;					// Valid before load once the header has been probed.
 	tString Filename;					// Valid before load.
 	tSystem::tFileType Filetype;		// Valid before load.
-	std::time_t FileModTime;			// Valid before load.
-	uint64 FileSizeB;					// Valid before load.
+	std::time_t FileModTime;			// Valid before load if FileInfoValid.
+	uint64 FileSizeB;					// Valid before load if FileInfoValid.
+	bool FileInfoValid = false;
+	uint32 TreeScanGeneration = 0;		// Set when a recursive folder scan finds the image. Used to spot removed files.
+	int CatalogEntry = -1;				// Maintained by ImageCatalog.
 
 	const static int ThumbWidth;		// = 256;
 	const static int ThumbHeight;		// = 144;
 	const static int ThumbMinDispWidth;	// = 64;
+	const static int ThumbNumLevels		= 4;
+	const static int ThumbStdLevel;		// = 2;	ThumbWidth by ThumbHeight. Every generation writes up to at least this.
+	static int GetThumbLevelWidth(int level)																			{ return ThumbMinDispWidth << level; }
+	static int GetThumbLevelHeight(int level)																			{ return GetThumbLevelWidth(level) * ThumbHeight / ThumbWidth; }
+
+	// Returns the smallest level at least as wide as the given pixel width. The top level is only used if allowed.
+	static int GetThumbLevel(float pixelWidth, bool allowTopLevel);
 	static tString ThumbCacheDir;
+	static ThumbnailAtlas ThumbAtlas;
+	static ThumbnailCache ThumbCache;
 
 	bool TypeSupportsProperties() const;
 
@@ -150,14 +204,72 @@ private:
 	std::thread ThumbnailThread;
 	std::atomic_flag ThumbnailThreadFlag = ATOMIC_FLAG_INIT;
 	tImage::tPicture ThumbnailPicture;
+	int ThumbnailLevel = -1;					// Of ThumbnailPicture, or the one being generated.
+	bool ThumbnailNeedsUpload = false;			// A new picture replaces whatever the atlas slot holds.
+	bool ThumbnailDropped = false;				// The picture was trimmed to save memory.
+
+	// Returns true if the worker had finished and was joined. With wait it's joined even if it's still working. Main
+	// thread only.
+	bool JoinThumbnailWorker(bool wait = false);
+
+	// Images holding a valid ThumbnailPicture are tracked so TrimThumbnailPictures doesn't visit every image. Main
+	// thread only and never while a worker owns the picture.
+	void HoldThumbnailPicture();
+	void ReleaseThumbnailPicture();
+	void MarkThumbnailDrawn();
+	int64 GetThumbnailPictureBytes() const																				{ return int64(ThumbnailPicture.GetNumPixels()) * sizeof(tPixel); }
+	int ThumbnailHolderIndex = -1;
+	uint64 ThumbnailLastDrawn = 0;
+	static uint64 ThumbnailFrame;
+	static int64 ThumbnailPicturesBytes;
+
+	// The holders drawn this frame, kept as we go so the trim knows what it can't drop without visiting them.
+	static int ThumbnailDrawnCount;
+	static int64 ThumbnailDrawnBytes;
+	const static int ThumbnailTrimPercent;		// = 90;
 
 	// These 2 functions run on a helper thread.
 	static void GenerateThumbnailBridge(Image*);
 	void GenerateThumbnail();
 
+	// A copy of the primary picture of a loaded image, given to the worker so it can skip the decode on a cache miss.
+	// Owned by the worker while it runs.
+	tImage::tPicture ThumbnailSource;
+	bool ThumbnailKeepDecode = false;
+
+	// Identifies the decoded pixels for DecodeShare. Covers the file and the load params that change the pixels.
+	uint64 GetDecodeKey() const;
+	static uint64 HashLoadParams(const tImage::tPicture::LoadParams&, uint64 seed = 0);
+	tString GetThumbnailCacheFile(const tSystem::tFileInfo&, int level) const;
+
+	// Keyed on the file bytes rather than the path so identical files anywhere share one set of thumbnails.
+	static tString GetThumbnailContentFile(uint64 contentHash, uint64 fileSize, int level);
+
 	// Zero is invalid and means texture has never been bound and loaded into VRAM.
 	uint TexIDAlt			= 0;
-	uint TexIDThumbnail		= 0;
+	ThumbnailAtlas::Slot ThumbnailSlot;
+
+	// Parts of a multi-part image are uploaded lazily as they are displayed. The resident parts are kept in LRU order
+	// (least recent first). When the pool is full the least recently used part gives up its texture ID and the ID is
+	// reused for the newly displayed part, so animations and large multi-page files only keep a window in VRAM.
+	static const int MaxResidentParts	= 16;
+	int NumResidentParts				= 0;
+	tImage::tPicture* ResidentParts[MaxResidentParts];
+	void TouchResidentPart(tImage::tPicture*);
+
+	// Pictures bigger than GL_MAX_TEXTURE_SIZE are split into a grid of tiles. Only the current picture is ever tiled
+	// and its tile textures are uploaded the first time they are drawn. A zero tile texture ID means not uploaded yet.
+	static int MaxTextureSize;
+	const static int MaxTileSize;		// = 4096;
+	static int GetMaxTextureSize();
+	tImage::tPicture* TiledPic			= nullptr;
+	int TileSize						= 0;
+	int NumTilesX						= 0;
+	int NumTilesY						= 0;
+	uint* TileTexIDs					= nullptr;
+	bool IsTiled() const;
+	void FreeTiles();
+	uint BindTile(int tileX, int tileY);
 
 	// Returns the approx main mem size of this image. Considers the Pictures list and the AltPicture.
 	int GetMemSizeBytes() const;
@@ -169,6 +281,8 @@ private:
 	void CreateAltPictureFromDDS_Cubemap();
 
 	float LoadedTime = -1.0f;
+	bool LoadedPrimaryOnly = false;
+	bool KeepDecode = false;					// Load leaves a copy of its decode in DecodeShare.
 	bool Dirty = false;
 };
 
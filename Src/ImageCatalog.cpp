@@ -0,0 +1,342 @@
+// ImageCatalog.cpp
+//
+// Column-oriented copy of the per-image fields needed for sorting. Sorting only touches these contiguous arrays, never
+// the Image objects themselves.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <thread>
+#include <algorithm>
+#include <System/tMachine.h>
+#include <Math/tFundamentals.h>
+#include "ImageCatalog.h"
+#include "Image.h"
+using namespace tMath;
+
+
+const int ImageCatalog::ParallelSortThreshold = 16384;
+
+
+namespace
+{
+	struct SortItem
+	{
+		uint64 Key;
+		int Entry;
+	};
+
+	// Sorts equal sized chunks on their own threads and then merges neighbouring chunks in rounds, also in parallel.
+	template<typename Less> void ParallelSort(SortItem* items, int count, Less less)
+	{
+		int numThreads = tMin(tSystem::tGetNumCores(), 8);
+		if ((count < ImageCatalog::ParallelSortThreshold) || (numThreads < 2))
+		{
+			std::sort(items, items + count, less);
+			return;
+		}
+
+		std::vector<int> bounds(numThreads + 1);
+		for (int t = 0; t <= numThreads; t++)
+			bounds[t] = int(int64(count) * t / numThreads);
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+			threads.emplace_back([=] { std::sort(items + bounds[t], items + bounds[t+1], less); });
+		for (std::thread& thread : threads)
+			thread.join();
+
+		for (int width = 1; width < numThreads; width *= 2)
+		{
+			threads.clear();
+			for (int t = 0; t + width < numThreads; t += 2*width)
+			{
+				SortItem* first		= items + bounds[t];
+				SortItem* middle	= items + bounds[t + width];
+				SortItem* last		= items + bounds[tMin(t + 2*width, numThreads)];
+				threads.emplace_back([=] { std::inplace_merge(first, middle, last, less); });
+			}
+			for (std::thread& thread : threads)
+				thread.join();
+		}
+	}
+}
+
+
+uint64 ImageCatalog::GetPrefix(const char* str)
+{
+	uint64 prefix = 0;
+	for (int c = 0; c < 8; c++)
+	{
+		char ch = *str;
+		if (ch)
+			str++;
+		ch = ((ch >= 'A') && (ch <= 'Z')) ? ch - 'A' + 'a' : ch;
+		prefix = (prefix << 8) | uint8(ch);
+	}
+	return prefix;
+}
+
+
+void ImageCatalog::AppendNaturalKey(std::vector<char>& pool, const char* path)
+{
+	const char* ch = path;
+	while (*ch)
+	{
+		if ((*ch < '0') || (*ch > '9'))
+		{
+			char lower = ((*ch >= 'A') && (*ch <= 'Z')) ? *ch - 'A' + 'a' : *ch;
+			pool.push_back(lower);
+			ch++;
+			continue;
+		}
+
+		// Leading zeros don't affect the value. An all zero run keeps its last zero.
+		while ((ch[0] == '0') && (ch[1] >= '0') && (ch[1] <= '9'))
+			ch++;
+		const char* digits = ch;
+		while ((*ch >= '0') && (*ch <= '9'))
+			ch++;
+
+		// The length byte can't be zero since that would end the key. Absurdly long runs are split, which still
+		// compares correctly for runs of equal length.
+		int numDigits = int(ch - digits);
+		while (numDigits > 0)
+		{
+			int chunk = tMin(numDigits, 255);
+			pool.push_back('0');
+			pool.push_back(char(uint8(chunk)));
+			pool.insert(pool.end(), digits, digits + chunk);
+			digits += chunk;
+			numDigits -= chunk;
+		}
+	}
+	pool.push_back('\0');
+}
+
+
+int ImageCatalog::GetPathAndKeySize(int entry) const
+{
+	return (NaturalOffsets[entry] - PathOffsets[entry]) + tStrlen(&PathPool[NaturalOffsets[entry]]) + 1;
+}
+
+
+void ImageCatalog::SetColumns(int entry, Image* img)
+{
+	// Every image normally lives under the root. If one doesn't, its full path is used.
+	const char* path = img->Filename.Chars();
+	if ((Root.Length() > 0) && (img->Filename.Length() > Root.Length()))
+		path += Root.Length();
+
+	// Most updates don't change the path. When they do the old one is simply abandoned and the pool gets compacted once
+	// more than half of it is waste.
+	bool samePath = (PathOffsets[entry] >= 0) && (tStrcmp(&PathPool[PathOffsets[entry]], path) == 0);
+	if (!samePath)
+	{
+		if (PathOffsets[entry] >= 0)
+			PathPoolWaste += GetPathAndKeySize(entry);
+		PathOffsets[entry] = int(PathPool.size());
+		PathPool.insert(PathPool.end(), path, path + tStrlen(path) + 1);
+		NaturalOffsets[entry] = int(PathPool.size());
+		AppendNaturalKey(PathPool, path);
+		PathPrefixes[entry] = GetPrefix(path);
+		NaturalPrefixes[entry] = GetPrefix(&PathPool[NaturalOffsets[entry]]);
+	}
+
+	ModTimes[entry]		= int64(img->FileModTime);
+	CaptureTimes[entry]	= img->Header.CaptureTime ? img->Header.CaptureTime : int64(img->FileModTime);
+	Sizes[entry]		= img->FileSizeB;
+	Types[entry]		= int(img->Filetype);
+	if (img->Info.IsValid())
+	{
+		Widths[entry]	= img->GetWidth();
+		Heights[entry]	= img->GetHeight();
+		Formats[entry]	= int(img->Info.SrcPixelFormat);
+	}
+	else
+	{
+		Widths[entry]	= img->Header.Width;
+		Heights[entry]	= img->Header.Height;
+		Formats[entry]	= int(img->Header.PixelFormat);
+	}
+}
+
+
+void ImageCatalog::Add(Image* img)
+{
+	int entry = GetNumEntries();
+	img->CatalogEntry = entry;
+	Images.push_back(img);
+	PathOffsets.push_back(-1);
+	PathPrefixes.push_back(0);
+	NaturalOffsets.push_back(-1);
+	NaturalPrefixes.push_back(0);
+	ModTimes.push_back(0);
+	Sizes.push_back(0);
+	Types.push_back(0);
+	Widths.push_back(0);
+	Heights.push_back(0);
+	Formats.push_back(0);
+	CaptureTimes.push_back(0);
+	SetColumns(entry, img);
+}
+
+
+void ImageCatalog::Update(Image* img)
+{
+	if ((img->CatalogEntry < 0) || (img->CatalogEntry >= GetNumEntries()) || (Images[img->CatalogEntry] != img))
+		return;
+
+	SetColumns(img->CatalogEntry, img);
+}
+
+
+void ImageCatalog::Remove(Image* img)
+{
+	int entry = img->CatalogEntry;
+	if ((entry < 0) || (entry >= GetNumEntries()) || (Images[entry] != img))
+		return;
+
+	PathPoolWaste += GetPathAndKeySize(entry);
+	int last = GetNumEntries() - 1;
+	if (entry != last)
+	{
+		Images[entry]		= Images[last];
+		PathOffsets[entry]	= PathOffsets[last];
+		PathPrefixes[entry]	= PathPrefixes[last];
+		NaturalOffsets[entry]	= NaturalOffsets[last];
+		NaturalPrefixes[entry]	= NaturalPrefixes[last];
+		ModTimes[entry]		= ModTimes[last];
+		Sizes[entry]		= Sizes[last];
+		Types[entry]		= Types[last];
+		Widths[entry]		= Widths[last];
+		Heights[entry]		= Heights[last];
+		Formats[entry]		= Formats[last];
+		CaptureTimes[entry]	= CaptureTimes[last];
+		Images[entry]->CatalogEntry = entry;
+	}
+
+	Images.pop_back();
+	PathOffsets.pop_back();
+	PathPrefixes.pop_back();
+	NaturalOffsets.pop_back();
+	NaturalPrefixes.pop_back();
+	ModTimes.pop_back();
+	Sizes.pop_back();
+	Types.pop_back();
+	Widths.pop_back();
+	Heights.pop_back();
+	Formats.pop_back();
+	CaptureTimes.pop_back();
+	img->CatalogEntry = -1;
+
+	if (PathPoolWaste > int(PathPool.size())/2)
+	{
+		std::vector<char> pool;
+		pool.reserve(PathPool.size() - PathPoolWaste);
+		for (int e = 0; e < GetNumEntries(); e++)
+		{
+			// The natural key follows the path so they move as one block.
+			const char* path = &PathPool[PathOffsets[e]];
+			int size = GetPathAndKeySize(e);
+			int offset = int(pool.size());
+			NaturalOffsets[e] = offset + (NaturalOffsets[e] - PathOffsets[e]);
+			PathOffsets[e] = offset;
+			pool.insert(pool.end(), path, path + size);
+		}
+		PathPool.swap(pool);
+		PathPoolWaste = 0;
+	}
+}
+
+
+void ImageCatalog::Clear()
+{
+	for (Image* img : Images)
+		img->CatalogEntry = -1;
+
+	Images.clear();
+	PathOffsets.clear();
+	PathPrefixes.clear();
+	NaturalOffsets.clear();
+	NaturalPrefixes.clear();
+	ModTimes.clear();
+	Sizes.clear();
+	Types.clear();
+	Widths.clear();
+	Heights.clear();
+	Formats.clear();
+	CaptureTimes.clear();
+	PathPool.clear();
+	PathPoolWaste = 0;
+}
+
+
+int ImageCatalog::ComparePaths(int entryA, int entryB) const
+{
+	if (PathPrefixes[entryA] != PathPrefixes[entryB])
+		return (PathPrefixes[entryA] < PathPrefixes[entryB]) ? -1 : 1;
+
+	return tStricmp(&PathPool[PathOffsets[entryA]], &PathPool[PathOffsets[entryB]]);
+}
+
+
+int ImageCatalog::CompareNatural(int entryA, int entryB) const
+{
+	if (NaturalPrefixes[entryA] != NaturalPrefixes[entryB])
+		return (NaturalPrefixes[entryA] < NaturalPrefixes[entryB]) ? -1 : 1;
+
+	return tStrcmp(&PathPool[NaturalOffsets[entryA]], &PathPool[NaturalOffsets[entryB]]);
+}
+
+
+void ImageCatalog::Sort(std::vector<int>& order, Viewer::Settings::SortKeyEnum sortKey, bool ascending) const
+{
+	// Build the primary key for every entry up front. Unsigned keys make descending order a simple bit flip.
+	int count = GetNumEntries();
+	std::vector<SortItem> items(count);
+	for (int e = 0; e < count; e++)
+	{
+		uint64 key = 0;
+		switch (sortKey)
+		{
+			case Viewer::Settings::SortKeyEnum::Alphabetical:	key = PathPrefixes[e];							break;
+			case Viewer::Settings::SortKeyEnum::FileModTime:	key = uint64(ModTimes[e]) ^ (uint64(1) << 63);	break;
+			case Viewer::Settings::SortKeyEnum::FileSize:		key = Sizes[e];									break;
+			case Viewer::Settings::SortKeyEnum::FileType:		key = uint64(Types[e]);							break;
+			case Viewer::Settings::SortKeyEnum::Dimensions:		key = uint64(Widths[e]) * uint64(Heights[e]);	break;
+			case Viewer::Settings::SortKeyEnum::PixelFormat:	key = uint64(Formats[e]);						break;
+			case Viewer::Settings::SortKeyEnum::Natural:		key = NaturalPrefixes[e];						break;
+			case Viewer::Settings::SortKeyEnum::CaptureTime:	key = uint64(CaptureTimes[e]) ^ (uint64(1) << 63);	break;
+		}
+		items[e].Key = ascending ? key : ~key;
+		items[e].Entry = e;
+	}
+
+	bool natural = (sortKey == Viewer::Settings::SortKeyEnum::Natural);
+	auto less = [this, ascending, natural](const SortItem& a, const SortItem& b)
+	{
+		if (a.Key != b.Key)
+			return a.Key < b.Key;
+
+		// Equal natural keys, like img07 and img7, fall through to the path compare.
+		int compare = natural ? CompareNatural(a.Entry, b.Entry) : 0;
+		if (compare == 0)
+			compare = ComparePaths(a.Entry, b.Entry);
+		if (compare != 0)
+			return ascending ? (compare < 0) : (compare > 0);
+		return a.Entry < b.Entry;
+	};
+	ParallelSort(items.data(), count, less);
+
+	order.resize(count);
+	for (int i = 0; i < count; i++)
+		order[i] = items[i].Entry;
+}
@@ -0,0 +1,79 @@
+// ImageCatalog.h
+//
+// Column-oriented copy of the per-image fields needed for sorting. Sorting only touches these contiguous arrays, never
+// the Image objects themselves.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <vector>
+#include <Foundation/tString.h>
+#include "Settings.h"
+class Image;
+
+
+// Each image has an entry index and entry e of every column describes the same image. Removing an image moves the last
+// entry into its place so the columns never have holes. The image's CatalogEntry member is kept up to date.
+class ImageCatalog
+{
+public:
+	ImageCatalog()																										{ }
+
+	// Paths are stored relative to the root so comparisons skip the common prefix. Only call when empty.
+	void SetRoot(const tString& rootDir)																				{ Root = rootDir; }
+
+	void Add(Image*);
+	void Remove(Image*);
+	void Clear();
+
+	// Call after the filename, mod time, size, header or load state of the image change. Loaded info is used over the
+	// probed header.
+	void Update(Image*);
+
+	int GetNumEntries() const																							{ return int(Images.size()); }
+	Image* GetImage(int entry) const																					{ return Images[entry]; }
+
+	// Fills order with every entry index in sorted order. Ties are broken by path so the order is deterministic. Large
+	// catalogs are sorted on multiple threads.
+	void Sort(std::vector<int>& order, Viewer::Settings::SortKeyEnum, bool ascending) const;
+
+	const static int ParallelSortThreshold;		// = 16384;
+
+private:
+	void SetColumns(int entry, Image*);
+	int ComparePaths(int entryA, int entryB) const;
+	int CompareNatural(int entryA, int entryB) const;
+
+	// The natural key of a path is stored right after it in the pool. It is lower-case and every run of digits becomes
+	// a '0' marker, the number of significant digits as a byte, then the digits. A plain byte compare of two keys then
+	// orders numbers by value, so img2 comes before img10.
+	static void AppendNaturalKey(std::vector<char>& pool, const char* path);
+	static uint64 GetPrefix(const char* str);
+	int GetPathAndKeySize(int entry) const;
+
+	// Columns.
+	std::vector<Image*> Images;
+	std::vector<int> PathOffsets;				// Into PathPool.
+	std::vector<uint64> PathPrefixes;			// First 8 lower-case bytes packed big-endian. Compares like tStricmp.
+	std::vector<int> NaturalOffsets;			// Into PathPool.
+	std::vector<uint64> NaturalPrefixes;		// First 8 bytes of the natural key packed big-endian.
+	std::vector<int64> ModTimes;
+	std::vector<uint64> Sizes;
+	std::vector<int> Types;
+	std::vector<int> Widths;					// Zero until known.
+	std::vector<int> Heights;
+	std::vector<int> Formats;					// A tPixelFormat. Invalid until known.
+	std::vector<int64> CaptureTimes;			// From the exif date when there is one, otherwise the mod time.
+
+	std::vector<char> PathPool;
+	int PathPoolWaste							= 0;
+	tString Root;
+};
@@ -0,0 +1,146 @@
+// ImageIndex.cpp
+//
+// A hash index over the Images list so lookups by path or by file name don't need to walk the list.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <Foundation/tStandard.h>
+#include "ImageIndex.h"
+#include "Image.h"
+
+
+const char* ImageIndex::GetKey(const char* filename) const
+{
+	if (!FileNameOnly)
+		return filename;
+
+	const char* key = filename;
+	for (const char* c = filename; *c; c++)
+		if ((*c == '/') || (*c == '\\'))
+			key = c + 1;
+	return key;
+}
+
+
+uint32 ImageIndex::ComputeHash(const char* key)
+{
+	// FNV-1a on the lower-cased key so the hash agrees with tStricmp.
+	uint32 hash = 2166136261u;
+	for (const char* c = key; *c; c++)
+	{
+		char lower = ((*c >= 'A') && (*c <= 'Z')) ? *c - 'A' + 'a' : *c;
+		hash = (hash ^ uint8(lower)) * 16777619u;
+	}
+	return hash;
+}
+
+
+void ImageIndex::Grow()
+{
+	Slot* oldSlots = Slots;
+	int oldCapacity = Capacity;
+
+	Capacity = Capacity ? Capacity*2 : 256;
+	Slots = new Slot[Capacity];
+	tMemset(Slots, 0, Capacity*sizeof(Slot));
+
+	int mask = Capacity - 1;
+	for (int s = 0; s < oldCapacity; s++)
+	{
+		if (!oldSlots[s].Img)
+			continue;
+
+		int slot = oldSlots[s].Hash & mask;
+		while (Slots[slot].Img)
+			slot = (slot + 1) & mask;
+		Slots[slot] = oldSlots[s];
+	}
+	delete[] oldSlots;
+}
+
+
+void ImageIndex::Add(Image* img)
+{
+	// Keep the load factor at or below one half so probe sequences stay short.
+	if ((Count + 1)*2 > Capacity)
+		Grow();
+
+	uint32 hash = ComputeHash(GetKey(img->Filename.Chars()));
+	int mask = Capacity - 1;
+	int slot = hash & mask;
+	while (Slots[slot].Img)
+		slot = (slot + 1) & mask;
+
+	Slots[slot].Img = img;
+	Slots[slot].Hash = hash;
+	Count++;
+}
+
+
+void ImageIndex::Remove(Image* img)
+{
+	if (!Count)
+		return;
+
+	int mask = Capacity - 1;
+	int slot = ComputeHash(GetKey(img->Filename.Chars())) & mask;
+	while (Slots[slot].Img && (Slots[slot].Img != img))
+		slot = (slot + 1) & mask;
+	if (!Slots[slot].Img)
+		return;
+
+	// Backward shift deletion. Later entries in the same cluster that would no longer be reachable are moved into the
+	// hole, so we never need tombstones.
+	int hole = slot;
+	int next = slot;
+	while (true)
+	{
+		next = (next + 1) & mask;
+		if (!Slots[next].Img)
+			break;
+
+		int home = Slots[next].Hash & mask;
+		bool reachable = (hole <= next) ? ((home > hole) && (home <= next)) : ((home > hole) || (home <= next));
+		if (!reachable)
+		{
+			Slots[hole] = Slots[next];
+			hole = next;
+		}
+	}
+	Slots[hole].Img = nullptr;
+	Count--;
+}
+
+
+void ImageIndex::Clear()
+{
+	if (Slots)
+		tMemset(Slots, 0, Capacity*sizeof(Slot));
+	Count = 0;
+}
+
+
+Image* ImageIndex::Find(const char* key) const
+{
+	if (!Count || !key)
+		return nullptr;
+
+	key = GetKey(key);
+	uint32 hash = ComputeHash(key);
+	int mask = Capacity - 1;
+	for (int slot = hash & mask; Slots[slot].Img; slot = (slot + 1) & mask)
+	{
+		const Slot& entry = Slots[slot];
+		if ((entry.Hash == hash) && (tStricmp(GetKey(entry.Img->Filename.Chars()), key) == 0))
+			return entry.Img;
+	}
+	return nullptr;
+}
@@ -0,0 +1,56 @@
+// ImageIndex.h
+//
+// A hash index over the Images list so lookups by path or by file name don't need to walk the list.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tString.h>
+class Image;
+
+
+// Open addressing with linear probing. Keys are either the full Filename of the image or just the file name part, and
+// are compared case-insensitively to match the old linear searches. The index does not own the images. An image must
+// be removed before its Filename changes and added again afterwards.
+class ImageIndex
+{
+public:
+	ImageIndex(bool fileNameOnly)																						: FileNameOnly(fileNameOnly) { }
+	~ImageIndex()																										{ delete[] Slots; }
+
+	void Add(Image*);
+	void Remove(Image*);
+	void Clear();
+
+	// For a file name index any directory part of the key is ignored, so a full path may be passed in. Returns
+	// nullptr if not found. Nothing is allocated.
+	Image* Find(const char* key) const;
+	Image* Find(const tString& key) const																				{ return Find(key.Chars()); }
+
+private:
+	ImageIndex(const ImageIndex&) = delete;
+	ImageIndex& operator=(const ImageIndex&) = delete;
+
+	struct Slot
+	{
+		Image* Img;							// Null if the slot is empty.
+		uint32 Hash;
+	};
+
+	const char* GetKey(const char* filename) const;
+	static uint32 ComputeHash(const char* key);
+	void Grow();
+
+	bool FileNameOnly;
+	Slot* Slots								= nullptr;
+	int Capacity							= 0;		// Always a power of two.
+	int Count								= 0;
+};
@@ -0,0 +1,169 @@
+// Profiler.cpp
+//
+// Lightweight timers and rolling sample histories for the profiler overlay. Samples may be recorded from any thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <mutex>
+#include <algorithm>
+#include <System/tPrint.h>
+#include "Profiler.h"
+
+
+namespace Profiler
+{
+	struct History
+	{
+		float Samples[HistorySize];
+		int Next		= 0;				// Where the next sample goes.
+		int Count		= 0;
+	};
+
+	History Histories[int(Metric::NumMetrics)];
+
+	// Thumbnail workers record from their own threads so the histories need protecting. Contention is low since
+	// samples arrive at most a few times per frame.
+	std::mutex HistoryMutex;
+
+	const char* Names[int(Metric::NumMetrics)] =
+	{
+		"Frame CPU",
+		"GPU Upload",
+		"Decode",
+		"Thumbnail",
+		"Thumb Queue",
+		"Thumb Workers"
+	};
+
+	const char* Units[int(Metric::NumMetrics)] =
+	{
+		"ms",
+		"ms",
+		"ms",
+		"ms",
+		"",
+		"%"
+	};
+
+	float Percentile(const float* sorted, int count, float p);
+}
+
+
+const char* Profiler::GetName(Metric metric)
+{
+	return Names[int(metric)];
+}
+
+
+const char* Profiler::GetUnits(Metric metric)
+{
+	return Units[int(metric)];
+}
+
+
+void Profiler::Record(Metric metric, float value)
+{
+	std::lock_guard<std::mutex> lock(HistoryMutex);
+	History& history = Histories[int(metric)];
+	history.Samples[history.Next] = value;
+	history.Next = (history.Next + 1) % HistorySize;
+	if (history.Count < HistorySize)
+		history.Count++;
+}
+
+
+int Profiler::GetHistory(Metric metric, float* dest, int maxSamples)
+{
+	std::lock_guard<std::mutex> lock(HistoryMutex);
+	const History& history = Histories[int(metric)];
+	int count = (history.Count < maxSamples) ? history.Count : maxSamples;
+
+	// The oldest sample is at Next once the ring has wrapped, otherwise at zero.
+	int start = (history.Next - count + HistorySize) % HistorySize;
+	for (int s = 0; s < count; s++)
+		dest[s] = history.Samples[(start + s) % HistorySize];
+
+	return count;
+}
+
+
+float Profiler::Percentile(const float* sorted, int count, float p)
+{
+	// Nearest-rank. With at most HistorySize samples interpolating buys us nothing.
+	int rank = int(p*float(count) + 0.5f);
+	if (rank < 1)
+		rank = 1;
+	if (rank > count)
+		rank = count;
+	return sorted[rank-1];
+}
+
+
+Profiler::Stats Profiler::GetStats(Metric metric)
+{
+	float sorted[HistorySize];
+	int count = GetHistory(metric, sorted, HistorySize);
+	Stats stats;
+	if (count == 0)
+		return stats;
+
+	std::sort(sorted, sorted + count);
+	float sum = 0.0f;
+	for (int s = 0; s < count; s++)
+		sum += sorted[s];
+
+	stats.NumSamples	= count;
+	stats.Mean			= sum / float(count);
+	stats.Max			= sorted[count-1];
+	stats.P50			= Percentile(sorted, count, 0.50f);
+	stats.P95			= Percentile(sorted, count, 0.95f);
+	stats.P99			= Percentile(sorted, count, 0.99f);
+	return stats;
+}
+
+
+void Profiler::Dump()
+{
+	tPrintf("Profiler (last %d samples per metric)\n", HistorySize);
+	for (int m = 0; m < int(Metric::NumMetrics); m++)
+	{
+		Stats stats = GetStats(Metric(m));
+		const char* units = GetUnits(Metric(m));
+		tPrintf
+		(
+			"  %-14s n:%-4d mean:%.2f%s p50:%.2f%s p95:%.2f%s p99:%.2f%s max:%.2f%s\n",
+			GetName(Metric(m)), stats.NumSamples,
+			stats.Mean, units, stats.P50, units, stats.P95, units, stats.P99, units, stats.Max, units
+		);
+	}
+}
+
+
+void Profiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(HistoryMutex);
+	for (int m = 0; m < int(Metric::NumMetrics); m++)
+	{
+		Histories[m].Next = 0;
+		Histories[m].Count = 0;
+	}
+}
+
+
+void Profiler::ScopedTimer::Stop()
+{
+	if (!Running)
+		return;
+
+	Running = false;
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - Start;
+	Record(TimedMetric, elapsed.count());
+}
@@ -0,0 +1,73 @@
+// Profiler.h
+//
+// Lightweight timers and rolling sample histories for the profiler overlay. Samples may be recorded from any thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <chrono>
+
+
+namespace Profiler
+{
+	enum class Metric
+	{
+		FrameCPU,							// Milliseconds spent in Viewer::Update, not counting the buffer swap.
+		GPUUpload,							// Milliseconds spent uploading a picture or tile to GL.
+		Decode,								// Milliseconds spent decoding an image file.
+		Thumbnail,							// Milliseconds to produce a thumbnail, including cache hits.
+		ThumbQueue,							// Number of visible thumbnails still waiting on a worker.
+		ThumbWorkers,						// Percent of the thumbnail worker threads that are busy.
+		NumMetrics
+	};
+
+	const char* GetName(Metric);
+	const char* GetUnits(Metric);
+
+	// Adds a sample to the metric's rolling history. The oldest sample is dropped once the history is full.
+	void Record(Metric, float value);
+
+	// Copies the history into dest, oldest first. Returns the number of samples copied.
+	int GetHistory(Metric, float* dest, int maxSamples);
+
+	struct Stats
+	{
+		int NumSamples	= 0;
+		float Mean		= 0.0f;
+		float Max		= 0.0f;
+		float P50		= 0.0f;
+		float P95		= 0.0f;
+		float P99		= 0.0f;
+	};
+	Stats GetStats(Metric);
+
+	// Prints the stats of every metric. The output ends up in the log window.
+	void Dump();
+	void Reset();
+
+	const int HistorySize					= 256;
+
+	// Records the elapsed milliseconds when it goes out of scope or when Stop is called, whichever happens first.
+	// Cancel discards the sample. Useful when an early-out means there was nothing worth measuring.
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(Metric metric)																							: TimedMetric(metric), Running(true), Start(std::chrono::steady_clock::now()) { }
+		~ScopedTimer()																										{ Stop(); }
+		void Stop();
+		void Cancel()																										{ Running = false; }
+
+	private:
+		Metric TimedMetric;
+		bool Running;
+		std::chrono::steady_clock::time_point Start;
+	};
+}
@@ -552,9 +552,7 @@ void Viewer::AddSavedImageIfNecessary(const tString& savedFile)
 	#endif
 	{
 		// Add to list. It's still unloaded.
-		Image* newImg = new Image(savedFile);
-		Images.Append(newImg);
-		ImagesLoadTimeSorted.Append(newImg);
+		AddImage(savedFile);
 	}
 }
 
@@ -39,6 +39,8 @@ void Viewer::Settings::ResetBehaviourSettings()
 {
 	SortKey						= 0;
 	SortAscending				= true;
+	RecursiveFolders			= false;
+	RecursiveMaxDepth			= 8;
 	ResampleFilter				= 2;
 	ConfirmDeletes				= true;
 	ConfirmFileOverwrites		= true;
@@ -50,7 +52,8 @@ void Viewer::Settings::ResetBehaviourSettings()
 	SaveFileJpegQuality			= 95;
 	SaveAllSizeMode				= 0;
 	MaxImageMemMB				= 1024;
-	MaxCacheFiles				= 7000;
+	MaxCacheSizeMB				= 1024;
+	MaxThumbnailMemMB			= 256;
 	AutoPropertyWindow			= true;
 	AutoPlayAnimatedImages		= true;
 	MonitorGamma				= tMath::DefaultGamma;
@@ -67,8 +70,11 @@ void Viewer::Settings::ResetUISettings(int screenW, int screenH)
 	ShowMenuBar					= true;
 	ShowNavBar					= true;
 	ShowImageDetails			= true;
+	ShowProfiler				= false;
 	ContentViewShow				= false;
 	ThumbnailWidth				= 128.0f;
+	ThumbnailHiDPI				= true;
+	ThumbnailDedup				= true;
 	OverlayCorner				= 3;
 	Tile						= false;
 	BackgroundStyle				= 1;
@@ -96,10 +102,15 @@ void Viewer::Settings::Load(const tString& filename, int screenW, int screenH)
 				ReadItem(ShowMenuBar);
 				ReadItem(ShowNavBar);
 				ReadItem(ShowImageDetails);
+				ReadItem(ShowProfiler);
 				ReadItem(ContentViewShow);
 				ReadItem(ThumbnailWidth);
+				ReadItem(ThumbnailHiDPI);
+				ReadItem(ThumbnailDedup);
 				ReadItem(SortKey);
 				ReadItem(SortAscending);
+				ReadItem(RecursiveFolders);
+				ReadItem(RecursiveMaxDepth);
 				ReadItem(OverlayCorner);
 				ReadItem(Tile);
 				ReadItem(BackgroundStyle);
@@ -115,7 +126,8 @@ void Viewer::Settings::Load(const tString& filename, int screenW, int screenH)
 				ReadItem(SaveFileJpegQuality);
 				ReadItem(SaveAllSizeMode);
 				ReadItem(MaxImageMemMB);
-				ReadItem(MaxCacheFiles);
+				ReadItem(MaxCacheSizeMB);
+				ReadItem(MaxThumbnailMemMB);
 				ReadItem(AutoPropertyWindow);
 				ReadItem(AutoPlayAnimatedImages);
 				ReadItem(MonitorGamma);
@@ -132,9 +144,11 @@ void Viewer::Settings::Load(const tString& filename, int screenW, int screenH)
 	tiClamp(OverlayCorner, 0, 3);
 	tiClamp(SaveFileType, 0, 4);
 	tiClamp(ThumbnailWidth, float(Image::ThumbMinDispWidth), float(Image::ThumbWidth));
-	tiClamp(SortKey, 0, 3);
+	tiClamp(SortKey, 0, 7);
+	tiClamp(RecursiveMaxDepth, 1, 64);
 	tiClampMin(MaxImageMemMB, 256);
-	tiClampMin(MaxCacheFiles, 200);
+	tiClampMin(MaxCacheSizeMB, 64);
+	tiClampMin(MaxThumbnailMemMB, 16);
 	tiClamp(SaveAllSizeMode, 0, 3);
 	tiClamp(SaveFileJpegQuality, 1, 100);
 }
@@ -153,10 +167,15 @@ bool Viewer::Settings::Save(const tString& filename)
 	WriteItem(ShowMenuBar);
 	WriteItem(ShowNavBar);
 	WriteItem(ShowImageDetails);
+	WriteItem(ShowProfiler);
 	WriteItem(ContentViewShow);
 	WriteItem(ThumbnailWidth);
+	WriteItem(ThumbnailHiDPI);
+	WriteItem(ThumbnailDedup);
 	WriteItem(SortKey);
 	WriteItem(SortAscending);
+	WriteItem(RecursiveFolders);
+	WriteItem(RecursiveMaxDepth);
 	WriteItem(OverlayCorner);
 	WriteItem(Tile);
 	WriteItem(BackgroundExtend);
@@ -172,7 +191,8 @@ bool Viewer::Settings::Save(const tString& filename)
 	WriteItem(SaveFileJpegQuality);
 	WriteItem(SaveAllSizeMode);
 	WriteItem(MaxImageMemMB);
-	WriteItem(MaxCacheFiles);
+	WriteItem(MaxCacheSizeMB);
+	WriteItem(MaxThumbnailMemMB);
 	WriteItem(AutoPropertyWindow);
 	WriteItem(AutoPlayAnimatedImages);
 	WriteItem(MonitorGamma);
@@ -28,17 +28,26 @@ namespace Viewer
 		bool ShowMenuBar;
 		bool ShowNavBar;
 		bool ShowImageDetails;
+		bool ShowProfiler;
 		bool ContentViewShow;
 		float ThumbnailWidth;
+		bool ThumbnailHiDPI;				// Allow 512 wide thumbnails when the display is scaled up.
+		bool ThumbnailDedup;				// Identical files share thumbnails. Costs a hash of the file on a miss.
 		enum class SortKeyEnum
 		{
 			Alphabetical,
 			FileModTime,
 			FileSize,
-			FileType
+			FileType,
+			Dimensions,
+			PixelFormat,
+			Natural,						// Alphabetical but numbers compare by value.
+			CaptureTime						// Exif date where there is one, otherwise the mod time.
 		};
 		int SortKey;						// Matches SortKeyEnum values.
 		bool SortAscending;					// Sort direction.
+		bool RecursiveFolders;				// Include images from subfolders, found in the background.
+		int RecursiveMaxDepth;				// How many subfolder levels to descend when RecursiveFolders is set.
 
 		int OverlayCorner;
 		bool Tile;
@@ -72,7 +81,8 @@ namespace Viewer
 		};
 		int SaveAllSizeMode;
 		int MaxImageMemMB;					// Max image mem before unloading images.
-		int MaxCacheFiles;					// Max number of cache files before removing oldest.
+		int MaxCacheSizeMB;					// Least recently used thumbnails are removed above this.
+		int MaxThumbnailMemMB;				// Thumbnail pixels kept in memory. The least recently drawn go above this.
 		bool AutoPropertyWindow;			// Auto display property editor window for supported file types.
 		bool AutoPlayAnimatedImages;		// Automatically play animated gifs and WebPs.
 		float MonitorGamma;					// Used when displaying HDR formats to do gamma correction.
@@ -0,0 +1,76 @@
+// StatFetcher.cpp
+//
+// Gathers file modification times and sizes for many files at once on worker threads so slow filesystems never stall
+// the main thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#elif defined(PLATFORM_LINUX)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "StatFetcher.h"
+
+
+const int StatFetcher::MaxWorkers = 8;
+
+
+#if defined(PLATFORM_LINUX)
+bool StatFetcher::GetFileStat(const tString& filename, std::time_t& modTime, uint64& fileSize)
+{
+	#ifdef STATX_MTIME
+	struct statx extInfo;
+	if (statx(AT_FDCWD, filename.Chars(), AT_STATX_DONT_SYNC, STATX_MTIME | STATX_SIZE, &extInfo) == 0)
+	{
+		modTime = std::time_t(extInfo.stx_mtime.tv_sec);
+		fileSize = uint64(extInfo.stx_size);
+		return true;
+	}
+	if (errno != ENOSYS)
+		return false;
+	#endif
+
+	// Older kernels and C libraries.
+	struct stat info;
+	if (stat(filename.Chars(), &info) != 0)
+		return false;
+
+	modTime = std::time_t(info.st_mtime);
+	fileSize = uint64(info.st_size);
+	return true;
+}
+
+
+#elif defined(PLATFORM_WINDOWS)
+bool StatFetcher::GetFileStat(const tString& filename, std::time_t& modTime, uint64& fileSize)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filename.Chars(), GetFileExInfoStandard, &data))
+		return false;
+
+	// File times count 100ns intervals since 1601.
+	uint64 fileTime = (uint64(data.ftLastWriteTime.dwHighDateTime) << 32) | uint64(data.ftLastWriteTime.dwLowDateTime);
+	modTime = std::time_t((fileTime - 116444736000000000ull) / 10000000ull);
+	fileSize = (uint64(data.nFileSizeHigh) << 32) | uint64(data.nFileSizeLow);
+	return true;
+}
+#endif
+
+
+void StatFetcher::Fetch(Result& result, const tStringItem& file)
+{
+	result.Filename = file;
+	result.Valid = GetFileStat(result.Filename, result.ModTime, result.FileSize);
+}
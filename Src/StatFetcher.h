@@ -0,0 +1,59 @@
+// StatFetcher.h
+//
+// Gathers file modification times and sizes for many files at once on worker threads so slow filesystems never stall
+// the main thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <ctime>
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+#include "BackgroundQueue.h"
+
+
+// Works the same way as the header prober. Stat calls are mostly latency so more workers are used. On network shares
+// this is what turns seconds of waiting into a fraction of that.
+class StatFetcher
+{
+public:
+	StatFetcher()																										: Queue(MaxWorkers, Fetch) { }
+
+	struct Result : public tLink<Result>
+	{
+		tString Filename;
+		bool Valid						= false;		// False if the file couldn't be stat'd.
+		std::time_t ModTime				= 0;
+		uint64 FileSize					= 0;
+	};
+
+	// Moves the files out of the list and onto the queue. Workers are started as needed.
+	void Add(tList<tStringItem>& files)																					{ Queue.Add(files); }
+	void Cancel()																										{ Queue.Cancel(); }
+
+	// Moves up to maxResults results into results. Returns true once nothing is queued, being stat'd, or waiting to be
+	// taken, after which IsActive returns false until more files are added.
+	bool TakeResults(tList<Result>& results, int maxResults)															{ return Queue.TakeResults(results, maxResults); }
+	bool IsActive() const																								{ return Queue.IsActive(); }
+
+	// Only asks for the mod time and size. On Linux statx is used and told it may return cached attributes, which
+	// avoids a round trip to the server for each file on NFS. Safe to call from any thread.
+	static bool GetFileStat(const tString& filename, std::time_t& modTime, uint64& fileSize);
+
+	const static int MaxWorkers;		// = 8;
+
+private:
+	StatFetcher(const StatFetcher&) = delete;
+	StatFetcher& operator=(const StatFetcher&) = delete;
+
+	static void Fetch(Result&, const tStringItem& file);
+	BackgroundQueue<tStringItem, Result> Queue;
+};
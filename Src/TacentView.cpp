@@ -16,6 +16,7 @@
 #include <dwmapi.h>
 #endif
 
+#include <algorithm>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>				// Include glfw3.h after our OpenGL declarations.
 
@@ -39,10 +40,22 @@
 #include "imgui_impl_opengl2.h"
 #include "TacentView.h"
 #include "Image.h"
+#include "IconAtlas.h"
 #include "Dialogs.h"
 #include "ContactSheet.h"
 #include "ContentView.h"
 #include "Crop.h"
+#include "DecodeShare.h"
+#include "DirScan.h"
+#include "DirWatcher.h"
+#include "ImageIndex.h"
+#include "ImageCatalog.h"
+#include "TreeScanner.h"
+#include "HeaderProbe.h"
+#include "StatFetcher.h"
+#include "HeaderCache.h"
+#include "CacheWarmer.h"
+#include "Profiler.h"
 #include "SaveDialogs.h"
 #include "Settings.h"
 #include "Version.cmake.h"
@@ -54,46 +67,87 @@ using namespace tMath;
 namespace Viewer
 {
 	tCommand::tParam ImageFileParam(1, "ImageFile", "File to open.");
+	tCommand::tOption WarmCacheOption
+	(
+		"Generate the thumbnails for every image in the ImageFile folder and its subfolders, then exit. No window is "
+		"opened. ImageFile may be a folder.", "warmcache", 'w'
+	);
 	NavLogBar NavBar;
 	tString ImagesDir;
-	tList<tStringItem> ImagesSubDirs;
+	FolderTree ImagesFolders;
 	tList<Image> Images;
 	tItList<Image> ImagesLoadTimeSorted	(false);
+	bool ImagesLoadTimeSortedStale				= false;	// Set when images are removed. Rebuilt before use.
 	tuint256 ImagesHash							= 0;
+	uint32 ImagesVersion						= 0;
 	Image* CurrImage							= nullptr;
+	DirWatcher ImagesDirWatcher;
+
+	// The indexes and catalog are kept in step with Images by AddImage, RemoveImage and ClearImages.
+	ImageIndex ImagesByPath						(false);
+	ImageIndex ImagesByName						(true);
+	ImageCatalog ImagesCatalog;
+
+	// Only used in recursive mode. Subfolder images are added as the scanner finds them.
+	TreeScanner ImagesTreeScanner;
+	uint32 TreeScanGeneration					= 0;
+	const int MaxTreeScanFilesPerFrame			= 4096;
+
+	// Every image's header is probed in the background so dimensions and formats are known before any decode. New
+	// images are queued here and handed to the prober once a frame.
+	HeaderProber ImagesHeaderProber;
+	tList<tStringItem> ImagesToProbe;
+	bool ImagesHeadersChanged					= false;
+	const int MaxHeaderResultsPerFrame			= 4096;
+
+	// Probe results persist between runs so re-opening a folder needs no header reads at all. Lookups need the file
+	// info so images without it yet wait for their stat.
+	HeaderCache ImagesHeaderCache;
+
+	// Images are added without stat'ing them. Their mod times and sizes are filled in as these results come back.
+	StatFetcher ImagesStatFetcher;
+	tList<tStringItem> ImagesToStat;
+	bool ImagesFileInfoChanged					= false;
+	const int MaxStatResultsPerFrame			= 8192;
 	
 	void LoadAppImages(const tString& dataDir);
 	void UnloadAppImages();
-	Image ReticleImage;
-	Image PrevImage;
-	Image NextImage;
-	Image PrevArrowImage;
-	Image NextArrowImage;
-	Image FlipHImage;
-	Image FlipVImage;
-	Image RotateACWImage;
-	Image RotateCWImage;
-	Image FullscreenImage;
-	Image WindowedImage;
-	Image SkipBeginImage;
-	Image SkipEndImage;
-	Image MipmapsImage;
-	Image CubemapImage;
-	Image RefreshImage;
-	Image RecycleImage;
-	Image PropEditImage;
-	Image InfoOverlayImage;
-	Image TileImage;
-	Image StopImage;
-	Image StopRevImage;
-	Image PlayImage;
-	Image PlayRevImage;
-	Image PlayLoopImage;
-	Image PlayOnceImage;
-	Image ContentViewImage;
-	Image UpFolderImage;
-	Image CropImage;
-	Image DefaultThumbnailImage;
+
+	// Adds the font to the ImGui font atlas. The rasterized atlas and glyph metrics are cached on disk so the TTF
+	// doesn't need to be rasterized on every launch.
+	void LoadFont(const tString& fontFile, float sizePixels, const tString& cacheFile);
+
+	IconAtlas Icons;
+	Icon ReticleIcon;
+	Icon PrevIcon;
+	Icon NextIcon;
+	Icon PrevArrowIcon;
+	Icon NextArrowIcon;
+	Icon FlipHIcon;
+	Icon FlipVIcon;
+	Icon RotateACWIcon;
+	Icon RotateCWIcon;
+	Icon FullscreenIcon;
+	Icon WindowedIcon;
+	Icon SkipBeginIcon;
+	Icon SkipEndIcon;
+	Icon MipmapsIcon;
+	Icon CubemapIcon;
+	Icon RefreshIcon;
+	Icon RecycleIcon;
+	Icon PropEditIcon;
+	Icon InfoOverlayIcon;
+	Icon TileIcon;
+	Icon StopIcon;
+	Icon StopRevIcon;
+	Icon PlayIcon;
+	Icon PlayRevIcon;
+	Icon PlayLoopIcon;
+	Icon PlayOnceIcon;
+	Icon ContentViewIcon;
+	Icon UpFolderIcon;
+	Icon CropIcon;
+	Icon DefaultThumbnailIcon;
 
 	GLFWwindow* Window							= nullptr;
 	double DisappearCountdown					= DisappearDuration;
@@ -156,23 +210,7 @@ namespace Viewer
 	void GlfwErrorCallback(int error, const char* description)															{ tPrintf("Glfw Error %d: %s\n", error, description); }
 
 	// When compare functions are used to sort, they result in ascending order if they return a < b.
-	bool Compare_AlphabeticalAscending(const tStringItem& a, const tStringItem& b)										{ return tStricmp(a.Chars(), b.Chars()) < 0; }
-	bool Compare_FileCreationTimeAscending(const tStringItem& a, const tStringItem& b)
-	{
-		tFileInfo ia; tGetFileInfo(ia, a);
-		tFileInfo ib; tGetFileInfo(ib, b);
-		return ia.CreationTime < ib.CreationTime;
-	}
 	bool Compare_ImageLoadTimeAscending(const Image& a, const Image& b)													{ return a.GetLoadedTime() < b.GetLoadedTime(); }
-	bool Compare_ImageFileNameAscending(const Image& a, const Image& b)													{ return tStricmp(a.Filename.Chars(), b.Filename.Chars()) < 0; }
-	bool Compare_ImageFileNameDescending(const Image& a, const Image& b)												{ return tStricmp(a.Filename.Chars(), b.Filename.Chars()) > 0; }
-	bool Compare_ImageFileTypeAscending(const Image& a, const Image& b)													{ return int(a.Filetype) < int(b.Filetype); }
-	bool Compare_ImageFileTypeDescending(const Image& a, const Image& b)												{ return int(a.Filetype) > int(b.Filetype); }
-	bool Compare_ImageModTimeAscending(const Image& a, const Image& b)													{ return a.FileModTime < b.FileModTime; }
-	bool Compare_ImageModTimeDescending(const Image& a, const Image& b)													{ return a.FileModTime > b.FileModTime; }
-	bool Compare_ImageFileSizeAscending(const Image& a, const Image& b)													{ return a.FileSizeB < b.FileSizeB; }
-	bool Compare_ImageFileSizeDescending(const Image& a, const Image& b)												{ return a.FileSizeB > b.FileSizeB; }
-	typedef bool ImageCompareFn(const Image&, const Image&);
 
 	bool OnPrevious();
 	bool OnNext();
@@ -184,9 +222,23 @@ namespace Viewer
 	void ApplyZoomDelta(float zoomDelta, float roundTo, bool correctPan);
 	void SetBasicViewAndBehaviour();
 	bool IsBasicViewAndBehaviour();
-	tString FindImageFilesInCurrentFolder(tList<tStringItem>& foundFiles);	// Returns the image folder.
-	tuint256 ComputeImagesHash(const tList<tStringItem>& files);
-	int RemoveOldCacheFiles(const tString& cacheDir);						// Returns num removed.
+	bool FindImageFilesInCurrentFolder(DirScan& scan, tString& imagesDir);	// Gets the image folder. False if unreadable.
+	tuint256 ComputeImagesHash(const DirScan& scan);						// Scan files must be sorted.
+	const ExtensionSet& GetImageExtensions();
+
+	// These patch Images in place for the directory watcher and PopulateImages.
+	void ProcessImagesDirEvents();
+	void StartTreeScan();													// Walks the subfolders again in recursive mode.
+	void ProcessTreeScan();
+	void ProcessHeaderProbes();
+	void ProcessFileStats();
+	bool IsInSubDir(const Image*);
+	void RefreshImage(Image*);
+	void InvalidateImage(Image*);
+	bool SetImageFileInfo(Image*, std::time_t modTime, uint64 fileSize);	// Returns true if the file was modified.
+	void RequestImageHeader(Image*);										// Cache hit or queues a probe.
+	void LinkImage(Image*);													// Adds to the list, indexes and catalog.
+	int WarmCache(const tString& cfgFile);									// Headless. Returns the exit code.
 
 	void Update(GLFWwindow* window, double dt, bool dopoll = true);
 	void WindowRefreshFun(GLFWwindow* window)																			{ Update(window, 0.0, false); }
@@ -244,36 +296,40 @@ void Viewer::DrawNavBar(float x, float y, float w, float h)
 }
 
 
-tString Viewer::FindImageFilesInCurrentFolder(tList<tStringItem>& foundFiles)
+bool Viewer::FindImageFilesInCurrentFolder(DirScan& scan, tString& imagesDir)
 {
-	tString imagesDir = tSystem::tGetCurrentDir();
+	imagesDir = tSystem::tGetCurrentDir();
 	if (ImageFileParam.IsPresent() && tSystem::tIsAbsolutePath(ImageFileParam.Get()))
 		imagesDir = tSystem::tGetDir(ImageFileParam.Get());
 
+	// The folder is read once. Files are matched against the extension set and subfolders are collected as we go.
 	tPrintf("Finding image files in %s\n", imagesDir.Chars());
-	tSystem::tFindFiles(foundFiles, imagesDir, "jpg");
-	tSystem::tFindFiles(foundFiles, imagesDir, "gif");
-	tSystem::tFindFiles(foundFiles, imagesDir, "webp");
-	tSystem::tFindFiles(foundFiles, imagesDir, "tga");
-	tSystem::tFindFiles(foundFiles, imagesDir, "png");
-	tSystem::tFindFiles(foundFiles, imagesDir, "tif");
-	tSystem::tFindFiles(foundFiles, imagesDir, "tiff");
-	tSystem::tFindFiles(foundFiles, imagesDir, "bmp");
-	tSystem::tFindFiles(foundFiles, imagesDir, "dds");
-	tSystem::tFindFiles(foundFiles, imagesDir, "hdr");
-	tSystem::tFindFiles(foundFiles, imagesDir, "rgbe");
-	tSystem::tFindFiles(foundFiles, imagesDir, "exr");
-	tSystem::tFindFiles(foundFiles, imagesDir, "ico");
-
-	return imagesDir;
+	if (!scan.Scan(imagesDir, &GetImageExtensions()))
+	{
+		tPrintf("Error: Unable to read folder %s\n", imagesDir.Chars());
+		return false;
+	}
+
+	return true;
+}
+
+
+const ExtensionSet& Viewer::GetImageExtensions()
+{
+	static const char* imageExtensions[] =
+	{
+		"jpg", "gif", "webp", "tga", "png", "tif", "tiff", "bmp", "dds", "hdr", "rgbe", "exr", "ico"
+	};
+	static const ExtensionSet imageExtensionSet(imageExtensions, sizeof(imageExtensions)/sizeof(*imageExtensions));
+	return imageExtensionSet;
 }
 
 
-tuint256 Viewer::ComputeImagesHash(const tList<tStringItem>& files)
+tuint256 Viewer::ComputeImagesHash(const DirScan& scan)
 {
-	tuint256 hash = 0;
-	for (tStringItem* item = files.First(); item; item = item->Next())
-		hash = tMath::tHashString256(item->Chars(), hash);
+	tuint256 hash = tMath::tHashString256(scan.GetDir().Chars());
+	for (int f = 0; f < scan.GetNumFiles(); f++)
+		hash = tMath::tHashString256(scan.GetFileName(f), hash);
 
 	return hash;
 }
@@ -281,104 +337,525 @@ tuint256 Viewer::ComputeImagesHash(const tList<tStringItem>& files)
 
 void Viewer::PopulateImagesSubDirs()
 {
-	ImagesSubDirs.Clear();
+	// The folder is relisted in the background. If nothing in it changed that's just a stat.
+	ImagesFolders.SetRoot(ImagesDir, &GetImageExtensions());
+}
+
+
+void Viewer::PopulateImages()
+{
+	CurrImage = nullptr;
+	DirScan scan;
+	tString imagesDir;
+	FindImageFilesInCurrentFolder(scan, imagesDir);					// An unreadable folder populates as empty.
+	ImagesFolders.SetRoot(imagesDir, &GetImageExtensions());
+
+	// We sort here so ComputeImagesHash always returns consistent values. It also lets us merge with the existing
+	// images below.
+	scan.SortFiles();
+	ImagesHash = ComputeImagesHash(scan);
+
+	// A different folder can't share any images with the current one.
+	if (!imagesDir.IsEqual(ImagesDir))
+	{
+		ClearImages();
+		ImagesDir = imagesDir;
+		ImagesCatalog.SetRoot(ImagesDir);
+	}
 
-	tList<tStringItem> foundDirs;
-	tFindDirs(foundDirs, ImagesDir, false);
-	for (tStringItem* dir = foundDirs.First(); dir; dir = dir->Next())
+	// Images that are still on disk and haven't been modified are kept, along with their decoded pixels, textures and
+	// thumbnails. We sort the existing images the same way as the scan so the two lists can be merged in one pass.
+	int numExisting = Images.GetNumItems();
+	Image** existing = new Image*[tMath::tMax(numExisting, 1)];
+	int numCollected = 0;
+	for (Image* img = Images.First(); img; img = img->Next())
+		existing[numCollected++] = img;
+
+	// In recursive mode the subfolder images belong to the tree scan. They are left alone here.
+	if (Config.RecursiveFolders)
 	{
-		tString relPath = tGetRelativePath(ImagesDir, *dir);
-		relPath = tGetSimplifiedPath(relPath);
-		if (relPath[relPath.Length()-1] == '/')
-			relPath.ExtractSuffix(1);
+		int numTopLevel = 0;
+		for (int e = 0; e < numCollected; e++)
+			if (!IsInSubDir(existing[e]))
+				existing[numTopLevel++] = existing[e];
+		numExisting = numTopLevel;
+	}
+
+	// Every existing image lives in ImagesDir so the name starts right after it.
+	int dirLength = ImagesDir.Length();
+	auto nameOf = [dirLength](const Image* img) -> const char*
+	{
+		return (img->Filename.Length() > dirLength) ? img->Filename.Chars() + dirLength : img->Filename.Chars();
+	};
+	std::sort
+	(
+		existing, existing + numExisting,
+		[&nameOf](const Image* a, const Image* b) { return DirScan::CompareNames(nameOf(a), nameOf(b)) < 0; }
+	);
+
+	int numAdded = 0, numRemoved = 0, numModified = 0;
+	int e = 0, f = 0;
+	while ((e < numExisting) || (f < scan.GetNumFiles()))
+	{
+		int compare =
+			(e >= numExisting) ? 1 :
+			(f >= scan.GetNumFiles()) ? -1 :
+			DirScan::CompareNames(nameOf(existing[e]), scan.GetFileName(f));
+
+		if (compare < 0)
+		{
+			RemoveImage(existing[e++]);
+			numRemoved++;
+		}
+		else if (compare > 0)
+		{
+			// It is important we don't call Load after newing. We save memory by not having all images loaded. If the
+			// directory enumeration gave us the file info there's no need to stat.
+			std::time_t modTime;
+			uint64 fileSize;
+			if (scan.GetFileInfo(f, modTime, fileSize))
+				AddImage(scan.GetFilePath(f), modTime, fileSize);
+			else
+				AddImage(scan.GetFilePath(f));
+			f++;
+			numAdded++;
+		}
+		else
+		{
+			// Without file info from the enumeration the check for modification happens when the stat comes back.
+			Image* img = existing[e++];
+			std::time_t modTime;
+			uint64 fileSize;
+			if (!scan.GetFileInfo(f++, modTime, fileSize))
+			{
+				ImagesToStat.Append(new tStringItem(img->Filename));
+			}
+			else if (SetImageFileInfo(img, modTime, fileSize))
+			{
+				InvalidateImage(img);
+				numModified++;
+			}
+		}
+	}
+	delete[] existing;
+
+	if (numExisting > 0)
+		tPrintf("Resynched images. %d added, %d removed, %d modified.\n", numAdded, numRemoved, numModified);
+	SortImages(Settings::SortKeyEnum(Config.SortKey), Config.SortAscending);
+
+	// Restarting on the same folder is free so we don't need to check if the folder changed.
+	ImagesDirWatcher.Start(ImagesDir);
+	StartTreeScan();
+}
 
-		ImagesSubDirs.Append(new tStringItem(relPath));
+
+void Viewer::StartTreeScan()
+{
+	if (!Config.RecursiveFolders)
+	{
+		ImagesTreeScanner.Cancel();
+		return;
 	}
+
+	// Existing images are kept. The walk just adds the new ones and removes any it didn't find.
+	TreeScanGeneration++;
+	ImagesTreeScanner.Start(ImagesDir, Config.RecursiveMaxDepth, &GetImageExtensions());
 }
 
 
-void Viewer::PopulateImages()
+bool Viewer::IsInSubDir(const Image* img)
 {
-	Images.Clear();
-	ImagesLoadTimeSorted.Clear();
+	const char* name = img->Filename.Chars() + tMath::tMin(ImagesDir.Length(), img->Filename.Length());
+	for (const char* c = name; *c; c++)
+		if (*c == '/')
+			return true;
+	return false;
+}
 
-	tList<tStringItem> foundFiles;
-	ImagesDir = FindImageFilesInCurrentFolder(foundFiles);
-	PopulateImagesSubDirs();
 
-	// We sort here so ComputeImagesHash always returns consistent values.
-	foundFiles.Sort(Compare_AlphabeticalAscending, tListSortAlgorithm::Merge);
-	ImagesHash = ComputeImagesHash(foundFiles);
+void Viewer::ProcessTreeScan()
+{
+	if (!ImagesTreeScanner.IsActive())
+		return;
+
+	// We take a bounded number of files per frame so a huge tree never stalls the UI. The files are appended unsorted
+	// while the scan runs and everything is sorted once at the end.
+	tList<tStringItem> files;
+	int numDirs = ImagesTreeScanner.GetNumDirsScanned();
+	bool done = ImagesTreeScanner.TakeFiles(files, MaxTreeScanFilesPerFrame);
+	for (tStringItem* file = files.First(); file; file = file->Next())
+	{
+		Image* img = FindImage(*file);
+		if (!img)
+			img = AddImage(*file);
+		img->TreeScanGeneration = TreeScanGeneration;
+	}
+
+	if (!done)
+		return;
 
-	for (tStringItem* filename = foundFiles.First(); filename; filename = filename->Next())
+	// Subfolder images the scan didn't find this time have gone away.
+	int numImages = 0;
+	for (Image* img = Images.First(); img; )
 	{
-		// It is important we don't call Load after newing. We save memory by not having all images loaded.
-		Image* newImg = new Image(*filename);
-		Images.Append(newImg);
-		ImagesLoadTimeSorted.Append(newImg);
+		Image* next = img->Next();
+		if (IsInSubDir(img) && (img->TreeScanGeneration != TreeScanGeneration))
+			RemoveImage(img);
+		else
+			numImages++;
+		img = next;
 	}
 
+	tPrintf("Recursive scan done. %d images in %d folders.\n", numImages, numDirs);
 	SortImages(Settings::SortKeyEnum(Config.SortKey), Config.SortAscending);
-	CurrImage = nullptr;
+	if (!CurrImage)
+		SetCurrentImage();
 }
 
 
-void Viewer::SortImages(Settings::SortKeyEnum key, bool ascending)
+void Viewer::ProcessHeaderProbes()
 {
-	ImageCompareFn* sortFn;
-	switch (key)
+	if (!ImagesToProbe.IsEmpty())
+		ImagesHeaderProber.Add(ImagesToProbe);
+	if (!ImagesHeaderProber.IsActive())
+		return;
+
+	tList<HeaderProber::Result> results;
+	bool done = ImagesHeaderProber.TakeResults(results, MaxHeaderResultsPerFrame);
+	for (HeaderProber::Result* result = results.First(); result; result = result->Next())
 	{
-		case Settings::SortKeyEnum::Alphabetical:
-			sortFn = ascending ? Compare_ImageFileNameAscending : &Compare_ImageFileNameDescending;
-			break;
+		// The image may have been removed while its header was being read.
+		Image* img = FindImage(result->Filename);
+		if (!img)
+			continue;
+
+		img->Header = result->Header;
+		ImagesCatalog.Update(img);
+		ImagesHeadersChanged = true;
+
+		// Failures are cached too. If the file info went stale during the probe the record is just never found.
+		if (img->FileInfoValid)
+			ImagesHeaderCache.Add(result->Header, img->Filename, img->FileModTime, img->FileSizeB);
+	}
 
-		case Settings::SortKeyEnum::FileModTime:
-			sortFn = ascending ? Compare_ImageModTimeAscending : Compare_ImageModTimeDescending;
-			break;
+	if (!done)
+		return;
 
-		case Settings::SortKeyEnum::FileSize:
-			sortFn = ascending ? Compare_ImageFileSizeAscending : Compare_ImageFileSizeDescending;
-			break;
+	// Re-sorting every batch would make the list jump around while the probe runs so it's done once at the end, and
+	// only if the sort key depends on the header.
+	Settings::SortKeyEnum sortKey = Settings::SortKeyEnum(Config.SortKey);
+	bool sortUsesHeader =
+		(sortKey == Settings::SortKeyEnum::Dimensions) || (sortKey == Settings::SortKeyEnum::PixelFormat) ||
+		(sortKey == Settings::SortKeyEnum::CaptureTime);
+	if (ImagesHeadersChanged && sortUsesHeader)
+		SortImages(sortKey, Config.SortAscending);
+	ImagesHeadersChanged = false;
+}
 
-		case Settings::SortKeyEnum::FileType:
-			sortFn = ascending ? Compare_ImageFileTypeAscending : Compare_ImageFileTypeDescending;
-			break;
+
+void Viewer::ProcessFileStats()
+{
+	if (!ImagesToStat.IsEmpty())
+		ImagesStatFetcher.Add(ImagesToStat);
+	if (!ImagesStatFetcher.IsActive())
+		return;
+
+	tList<StatFetcher::Result> results;
+	bool done = ImagesStatFetcher.TakeResults(results, MaxStatResultsPerFrame);
+	for (StatFetcher::Result* result = results.First(); result; result = result->Next())
+	{
+		Image* img = FindImage(result->Filename);
+		if (!img || !result->Valid)
+			continue;
+
+		if (SetImageFileInfo(img, result->ModTime, result->FileSize))
+			InvalidateImage(img);
+		else if (!img->Header.IsValid())
+			RequestImageHeader(img);
+		ImagesFileInfoChanged = true;
 	}
 
-	Images.Sort(sortFn);
+	if (!done)
+		return;
+
+	// Like the header probe, a sort that depends on the file info is redone once everything is in.
+	Settings::SortKeyEnum sortKey = Settings::SortKeyEnum(Config.SortKey);
+	bool sortUsesFileInfo =
+		(sortKey == Settings::SortKeyEnum::FileModTime) || (sortKey == Settings::SortKeyEnum::FileSize) ||
+		(sortKey == Settings::SortKeyEnum::CaptureTime);
+	if (ImagesFileInfoChanged && sortUsesFileInfo)
+		SortImages(sortKey, Config.SortAscending);
+	ImagesFileInfoChanged = false;
 }
 
 
-Image* Viewer::FindImage(const tString& filename)
+Image* Viewer::AddImage(const tString& filename)
 {
-	Image* img = nullptr;
-	for (Image* si = Images.First(); si; si = si->Next())
-	{
-		if (si->Filename.IsEqualCI(filename))
-		{
-			img = si;
-			break;
-		}
-	}
+	// The header is requested once the stat comes back.
+	Image* img = new Image(filename, false);
+	LinkImage(img);
+	ImagesToStat.Append(new tStringItem(filename));
+	return img;
+}
 
+
+Image* Viewer::AddImage(const tString& filename, std::time_t modTime, uint64 fileSize)
+{
+	Image* img = new Image(filename, false);
+	img->FileModTime = modTime;
+	img->FileSizeB = fileSize;
+	img->FileInfoValid = true;
+	LinkImage(img);
+	RequestImageHeader(img);
 	return img;
 }
 
 
-void Viewer::SetCurrentImage(const tString& currFilename)
+void Viewer::LinkImage(Image* img)
+{
+	// The caller makes sure the image isn't already in the list.
+	Images.Append(img);
+	ImagesVersion++;
+	ImagesLoadTimeSorted.Append(img);
+	ImagesByPath.Add(img);
+	ImagesByName.Add(img);
+	ImagesCatalog.Add(img);
+}
+
+
+void Viewer::RequestImageHeader(Image* img)
+{
+	if (!img->FileInfoValid)
+		return;
+
+	if (ImagesHeaderCache.Find(img->Header, img->Filename, img->FileModTime, img->FileSizeB))
+		ImagesCatalog.Update(img);
+	else
+		ImagesToProbe.Append(new tStringItem(img->Filename));
+}
+
+
+void Viewer::RemoveImage(Image* img)
+{
+	if (img == CurrImage)
+		CurrImage = img->Next() ? img->Next() : img->Prev();
+
+	// Finding the image in the load time list is linear so removing many images would be quadratic. The list is
+	// rebuilt the next time it's needed instead.
+	ImagesLoadTimeSortedStale = true;
+	ImagesByPath.Remove(img);
+	ImagesByName.Remove(img);
+	ImagesCatalog.Remove(img);
+	Images.Remove(img);
+	ImagesVersion++;
+	delete img;
+}
+
+
+void Viewer::ClearImages()
+{
+	CurrImage = nullptr;
+	ImagesByPath.Clear();
+	ImagesByName.Clear();
+	ImagesCatalog.Clear();
+	ImagesLoadTimeSorted.Clear();
+	ImagesLoadTimeSortedStale = false;
+	ImagesHeaderProber.Cancel();
+	ImagesToProbe.Clear();
+	ImagesStatFetcher.Cancel();
+	ImagesToStat.Clear();
+	Images.Clear();
+	DecodeShare::Clear();
+	ImagesVersion++;
+}
+
+
+void Viewer::RefreshImage(Image* img)
+{
+	// We already know the file changed so the new file info is just for display and sorting. It is fetched in the
+	// background and since the old info is marked invalid it won't be seen as a second modification.
+	img->FileInfoValid = false;
+	ImagesToStat.Append(new tStringItem(img->Filename));
+	InvalidateImage(img);
+}
+
+
+bool Viewer::SetImageFileInfo(Image* img, std::time_t modTime, uint64 fileSize)
+{
+	// Info that was already valid and has changed means the file was modified behind our back.
+	bool modified = img->FileInfoValid && ((modTime != img->FileModTime) || (fileSize != img->FileSizeB));
+	img->FileModTime = modTime;
+	img->FileSizeB = fileSize;
+	img->FileInfoValid = true;
+	ImagesCatalog.Update(img);
+	return modified;
+}
+
+
+void Viewer::InvalidateImage(Image* img)
+{
+	img->Header = ImageHeader();
+	ImagesCatalog.Update(img);
+	RequestImageHeader(img);
+
+	// The decoded pixels and textures are stale. They get reloaded next time the image is displayed. If there are
+	// unsaved edits we leave the pixels alone rather than silently throw the edits away.
+	img->RequestInvalidateThumbnail();
+	if (img->IsDirty())
+		return;
+
+	img->Unbind();
+	img->Unload(true);
+}
+
+
+void Viewer::ProcessImagesDirEvents()
 {
-	for (Image* si = Images.First(); si; si = si->Next())
+	tList<DirWatcher::Event> events;
+	ImagesDirWatcher.GetEvents(events);
+	if (events.IsEmpty())
+		return;
+
+	const ExtensionSet& extensions = GetImageExtensions();
+	const tString& dir = ImagesDirWatcher.GetDir();
+	Image* origImage = CurrImage;
+	bool resort = false;
+	for (DirWatcher::Event* event = events.First(); event; event = event->Next())
 	{
-		tString siName = tSystem::tGetFileName(si->Filename);
-		tString imgName = tSystem::tGetFileName(currFilename);
+		if (event->Type == DirWatcher::EventType::Rescan)
+		{
+			tPrintf("Lost track of %s. Rescanning.\n", dir.Chars());
+			tString currFile = CurrImage ? CurrImage->Filename : tString();
+			PopulateImages();
+			SetCurrentImage(currFile);
+			return;
+		}
+
+		// Subfolders are picked up when the folder tree is relisted below.
+		if (event->IsDir)
+			continue;
 
-		if (tStricmp(siName.Chars(), imgName.Chars()) == 0)
+		tString filename = dir + event->Name;
+		Image* img = FindImage(filename);
+		switch (event->Type)
 		{
-			CurrImage = si;
-			break;
+			case DirWatcher::EventType::Added:
+				if (!img && extensions.ContainsFile(event->Name))
+				{
+					AddImage(filename);
+					resort = true;
+				}
+				break;
+
+			case DirWatcher::EventType::Removed:
+				if (img)
+					RemoveImage(img);
+				break;
+
+			case DirWatcher::EventType::Modified:
+				if (img)
+				{
+					RefreshImage(img);
+					resort = true;
+				}
+				else if (extensions.ContainsFile(event->Name))
+				{
+					AddImage(filename);
+					resort = true;
+				}
+				break;
+
+			case DirWatcher::EventType::Renamed:
+			{
+				tString newFilename = dir + event->NewName;
+				bool newIsImage = extensions.ContainsFile(event->NewName);
+				Image* target = FindImage(newFilename);
+				if (target && (target != img))
+				{
+					// Renamed over an existing image, which is how most editors save through a temp file. The target
+					// keeps its place and just has new contents. The source name is gone.
+					if (img)
+					{
+						if (CurrImage == img)
+							CurrImage = target;
+						RemoveImage(img);
+					}
+					RefreshImage(target);
+				}
+				else if (img && newIsImage)
+				{
+					// The Image object survives the rename. Only the thumbnail needs redoing since the cache is
+					// keyed on the filename. The worker reads the filename, so it must finish first.
+					img->WaitForThumbnailWorker();
+					ImagesByPath.Remove(img);
+					ImagesByName.Remove(img);
+					img->Filename = newFilename;
+					img->Filetype = tGetFileType(newFilename);
+					ImagesByPath.Add(img);
+					ImagesByName.Add(img);
+					ImagesCatalog.Update(img);
+					img->RequestInvalidateThumbnail();
+				}
+				else if (img)
+				{
+					RemoveImage(img);
+				}
+				else if (newIsImage)
+				{
+					AddImage(newFilename);
+				}
+				resort = true;
+				break;
+			}
+
+			default:
+				break;
 		}
 	}
 
+	if (resort)
+		SortImages(Settings::SortKeyEnum(Config.SortKey), Config.SortAscending);
+
+	// The folder tree picks up added, removed and renamed subfolders from a fresh listing. Image files coming and going
+	// also change the counts so any event will do.
+	if (ImagesFolders.GetRoot())
+		ImagesFolders.Refresh(ImagesFolders.GetRoot());
+
+	if (CurrImage && ((CurrImage != origImage) || !CurrImage->IsLoaded()))
+		LoadCurrImage();
+	SetWindowTitle();
+}
+
+
+void Viewer::SortImages(Settings::SortKeyEnum key, bool ascending)
+{
+	// The sort itself only reads the catalog columns. Afterwards the list is relinked in the new order, which is the
+	// only time each Image is touched.
+	std::vector<int> order;
+	ImagesCatalog.Sort(order, key, ascending);
+
+	Images.Empty();
+	for (int entry : order)
+		Images.Append(ImagesCatalog.GetImage(entry));
+	ImagesVersion++;
+}
+
+
+Image* Viewer::FindImage(const tString& filename)
+{
+	return ImagesByPath.Find(filename);
+}
+
+
+void Viewer::SetCurrentImage(const tString& currFilename)
+{
+	// An exact path match is preferred. In recursive mode the same file name may exist in more than one folder.
+	Image* found = ImagesByPath.Find(currFilename);
+	if (!found)
+		found = ImagesByName.Find(currFilename);
+	if (found)
+		CurrImage = found;
+
 	if (!CurrImage)
 	{
 		CurrImage = Images.First();
@@ -402,6 +879,8 @@ void Viewer::LoadCurrImage()
 	bool imgJustLoaded = false;
 	if (!CurrImage->IsLoaded())
 		imgJustLoaded = CurrImage->Load();
+	if (imgJustLoaded)
+		ImagesCatalog.Update(CurrImage);
 
 	if (Config.AutoPropertyWindow)
 		PropEditorWindow = (CurrImage->TypeSupportsProperties() || (CurrImage->GetNumParts() > 1));
@@ -425,6 +904,13 @@ void Viewer::LoadCurrImage()
 	bool slideshowSmallDuration = SlideshowPlaying && (Config.SlidehowFrameDuration < 0.5f);
 	if (imgJustLoaded && !slideshowSmallDuration)
 	{
+		if (ImagesLoadTimeSortedStale)
+		{
+			ImagesLoadTimeSorted.Clear();
+			for (Image* i = Images.First(); i; i = i->Next())
+				ImagesLoadTimeSorted.Append(i);
+			ImagesLoadTimeSortedStale = false;
+		}
 		ImagesLoadTimeSorted.Sort(Compare_ImageLoadTimeAscending);
 
 		int64 usedMem = 0;
@@ -539,6 +1025,25 @@ void Viewer::ShowHelpMark(const char* desc)
 }
 
 
+bool Viewer::IconButton
+(
+	const Icon& icon, const tVector2& size, bool flipV, int framePadding,
+	const tVector4& bgCol, const tVector4& tintCol
+)
+{
+	// ImGui uses the texture ID for the button ID. All icons share the atlas texture so we need to push something
+	// unique or every icon button in a window would respond to the same clicks.
+	ImGui::PushID(&icon);
+	bool pressed = ImGui::ImageButton
+	(
+		ImTextureID(icon.Bind()), size, icon.GetUV0(flipV), icon.GetUV1(flipV), framePadding,
+		bgCol, tintCol
+	);
+	ImGui::PopID();
+	return pressed;
+}
+
+
 void Viewer::ShowToolTip(const char* desc)
 {
 	if (!ImGui::IsItemHovered())
@@ -759,6 +1264,25 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 	// two flags.
 	if (dopoll)
 		glfwPollEvents();
+	ProcessImagesDirEvents();
+	ProcessTreeScan();
+	ProcessFileStats();
+	ProcessHeaderProbes();
+	ImagesFolders.Update();
+	Image::ThumbCache.Update(int64(Config.MaxCacheSizeMB) * 1024 * 1024);
+	Image::ReapThumbnailWorkers();
+	Image::TrimThumbnailPictures(int64(Config.MaxThumbnailMemMB) * 1024 * 1024);
+
+	// Thumbnail decodes kept for the viewer to pick up may use a quarter of the image memory budget.
+	DecodeShare::SetBudget(int64(Config.MaxImageMemMB) * 1024 * 1024 / 4);
+
+	// The frame timer stops before the buffer swap so vsync waits don't show up as CPU time.
+	Profiler::ScopedTimer frameTimer(Profiler::Metric::FrameCPU);
+	Profiler::Record
+	(
+		Profiler::Metric::ThumbWorkers,
+		100.0f * float(Image::GetThumbnailNumThreadsRunning()) / float(Image::GetThumbnailNumThreadsMax())
+	);
 
 	glClearColor(ColourClear.x, ColourClear.y, ColourClear.z, ColourClear.w);
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -912,24 +1436,28 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		CurrImage->Bind();
 		glEnable(GL_TEXTURE_2D);
 
-		glBegin(GL_QUADS);
+		// The uvs here are in normalized image space. The image takes care of mapping them to its tiles if it was too
+		// big for a single texture, so ConvertScreenPosToImagePos doesn't need to know about tiling.
 		if (!Config.Tile)
 		{
-			glTexCoord2f(0.0f + uvUMarg + uvUOff, 0.0f + uvVMarg + uvVOff); glVertex2f(l, b);
-			glTexCoord2f(0.0f + uvUMarg + uvUOff, 1.0f - uvVMarg + uvVOff); glVertex2f(l, t);
-			glTexCoord2f(1.0f - uvUMarg + uvUOff, 1.0f - uvVMarg + uvVOff); glVertex2f(r, t);
-			glTexCoord2f(1.0f - uvUMarg + uvUOff, 0.0f + uvVMarg + uvVOff); glVertex2f(r, b);
+			CurrImage->DrawQuad
+			(
+				l, b, r, t,
+				0.0f + uvUMarg + uvUOff, 0.0f + uvVMarg + uvVOff,
+				1.0f - uvUMarg + uvUOff, 1.0f - uvVMarg + uvVOff
+			);
 		}
 		else
 		{
 			float repU = draww/(r-l);	float offU = (1.0f-repU)/2.0f;
 			float repV = drawh/(t-b);	float offV = (1.0f-repV)/2.0f;
-			glTexCoord2f(offU + 0.0f + uvUMarg + uvUOff,	offV + 0.0f + uvVMarg + uvVOff);	glVertex2f(hmargin,			vmargin);
-			glTexCoord2f(offU + 0.0f + uvUMarg + uvUOff,	offV + repV - uvVMarg + uvVOff);	glVertex2f(hmargin,			vmargin+drawh);
-			glTexCoord2f(offU + repU - uvUMarg + uvUOff,	offV + repV - uvVMarg + uvVOff);	glVertex2f(hmargin+draww,	vmargin+drawh);
-			glTexCoord2f(offU + repU - uvUMarg + uvUOff,	offV + 0.0f + uvVMarg + uvVOff);	glVertex2f(hmargin+draww,	vmargin);
+			CurrImage->DrawQuad
+			(
+				hmargin, vmargin, hmargin+draww, vmargin+drawh,
+				offU + 0.0f + uvUMarg + uvUOff, offV + 0.0f + uvVMarg + uvVOff,
+				offU + repU - uvUMarg + uvUOff, offV + repV - uvVMarg + uvVOff
+			);
 		}
-		glEnd();
 
 		// Get the colour under the reticle.
 		tVector2 scrCursorPos(ReticleX, ReticleY);
@@ -984,17 +1512,19 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 			else
 			{
 				// Draw the reticle.
-				float cw = float((ReticleImage.GetWidth()) >> 1);
-				float ch = float((ReticleImage.GetHeight()) >> 1);
+				float cw = float((ReticleIcon.GetWidth()) >> 1);
+				float ch = float((ReticleIcon.GetHeight()) >> 1);
 				float cx = ReticleX;
 				float cy = ReticleY;
+				tVector2 uvMin = ReticleIcon.GetUV0(true);
+				tVector2 uvMax = ReticleIcon.GetUV1(true);
 				glEnable(GL_TEXTURE_2D);
-				ReticleImage.Bind();
+				ReticleIcon.Bind();
 				glBegin(GL_QUADS);
-				glTexCoord2f(0.0f, 0.0f); glVertex2f(cx-cw, cy+ch);
-				glTexCoord2f(0.0f, 1.0f); glVertex2f(cx-cw, cy-ch);
-				glTexCoord2f(1.0f, 1.0f); glVertex2f(cx+cw, cy-ch);
-				glTexCoord2f(1.0f, 0.0f); glVertex2f(cx+cw, cy+ch);
+				glTexCoord2f(uvMin.u, uvMin.v); glVertex2f(cx-cw, cy+ch);
+				glTexCoord2f(uvMin.u, uvMax.v); glVertex2f(cx-cw, cy-ch);
+				glTexCoord2f(uvMax.u, uvMax.v); glVertex2f(cx+cw, cy-ch);
+				glTexCoord2f(uvMax.u, uvMin.v); glVertex2f(cx+cw, cy+ch);
 				glEnd();
 				glDisable(GL_TEXTURE_2D);
 			}
@@ -1041,7 +1571,7 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 			ImGui::SetNextWindowSize(tVector2(16, 70), ImGuiCond_Always);
 			ImGui::Begin("PrevArrow", nullptr, flagsImgButton);
 			ImGui::SetCursorPos(tVector2(6, 2));
-			if (ImGui::ImageButton(ImTextureID(PrevArrowImage.Bind()), tVector2(15,56), tVector2(0,0), tVector2(1,1), 3, tVector4(0,0,0,0), tVector4(1,1,1,1)))
+			if (IconButton(PrevArrowIcon, tVector2(15,56), true, 3, tVector4(0,0,0,0), tVector4(1,1,1,1)))
 				OnPrevious();
 			ImGui::End();
 		}
@@ -1053,7 +1583,7 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 			ImGui::SetNextWindowSize(tVector2(16, 70), ImGuiCond_Always);
 			ImGui::Begin("NextArrow", nullptr, flagsImgButton);
 			ImGui::SetCursorPos(tVector2(6, 2));
-			if (ImGui::ImageButton(ImTextureID(NextArrowImage.Bind()), tVector2(15,56), tVector2(0,0), tVector2(1,1), 3, tVector4(0,0,0,0), tVector4(1,1,1,1)))
+			if (IconButton(NextArrowIcon, tVector2(15,56), true, 3, tVector4(0,0,0,0), tVector4(1,1,1,1)))
 				OnNext();
 			ImGui::End();
 		}
@@ -1062,8 +1592,8 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ImGui::SetNextWindowPos(tVector2((workAreaW>>1)-22.0f-120.0f, float(topUIHeight) + float(workAreaH) - 42.0f));
 		ImGui::SetNextWindowSize(tVector2(40, 40), ImGuiCond_Always);
 		ImGui::Begin("Repeat", nullptr, flagsImgButton);
-		uint64 playModeImageID = Config.SlideshowLooping ? PlayOnceImage.Bind() : PlayLoopImage.Bind();
-		if (ImGui::ImageButton(ImTextureID(playModeImageID), tVector2(24,24), tVector2(0,0), tVector2(1,1), 2, tVector4(0,0,0,0), tVector4(1,1,1,1)))
+		const Icon& playModeIcon = Config.SlideshowLooping ? PlayOnceIcon : PlayLoopIcon;
+		if (IconButton(playModeIcon, tVector2(24,24), true, 2, tVector4(0,0,0,0), tVector4(1,1,1,1)))
 			Config.SlideshowLooping = !Config.SlideshowLooping;
 		ImGui::End();
 
@@ -1072,9 +1602,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ImGui::SetNextWindowPos(tVector2((workAreaW>>1)-22.0f-80.0f, float(topUIHeight) + float(workAreaH) - 42.0f));
 		ImGui::SetNextWindowSize(tVector2(40, 40), ImGuiCond_Always);
 		ImGui::Begin("SkipBegin", nullptr, flagsImgButton);
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(SkipBeginImage.Bind()), tVector2(24,24), tVector2(0,0), tVector2(1,1), 2,
+			SkipBeginIcon, tVector2(24,24), true, 2,
 			ColourBG, prevAvail ? ColourEnabledTint : ColourDisabledTint) && prevAvail
 		)	OnSkipBegin();
 		ImGui::End();
@@ -1083,9 +1613,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ImGui::SetNextWindowPos(tVector2((workAreaW>>1)-22.0f-40.0f, float(topUIHeight) + float(workAreaH) - 42.0f));
 		ImGui::SetNextWindowSize(tVector2(40, 40), ImGuiCond_Always);
 		ImGui::Begin("Prev", nullptr, flagsImgButton);
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(PrevImage.Bind()), tVector2(24,24), tVector2(0,0), tVector2(1,1), 2,
+			PrevIcon, tVector2(24,24), true, 2,
 			ColourBG, prevAvail ? ColourEnabledTint : ColourDisabledTint) && prevAvail
 		)	OnPrevious();
 		ImGui::End();
@@ -1094,8 +1624,8 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ImGui::SetNextWindowPos(tVector2((workAreaW>>1)-22.0f+0.0f, float(topUIHeight) + float(workAreaH) - 42.0f));
 		ImGui::SetNextWindowSize(tVector2(40, 40), ImGuiCond_Always);
 		ImGui::Begin("Slideshow", nullptr, flagsImgButton);
-		uint64 psImageID = SlideshowPlaying ? StopImage.Bind() : PlayImage.Bind();
-		if (ImGui::ImageButton(ImTextureID(psImageID), tVector2(24,24), tVector2(0,0), tVector2(1,1), 2, tVector4(0,0,0,0), tVector4(1,1,1,1)))
+		const Icon& psIcon = SlideshowPlaying ? StopIcon : PlayIcon;
+		if (IconButton(psIcon, tVector2(24,24), true, 2, tVector4(0,0,0,0), tVector4(1,1,1,1)))
 		{
 			SlideshowPlaying = !SlideshowPlaying;
 			SlideshowCountdown = Config.SlidehowFrameDuration;
@@ -1107,9 +1637,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ImGui::SetNextWindowPos(tVector2((workAreaW>>1)-22.0f+40.0f, float(topUIHeight) + float(workAreaH) - 42.0f));
 		ImGui::SetNextWindowSize(tVector2(40, 40), ImGuiCond_Always);
 		ImGui::Begin("Next", nullptr, flagsImgButton);
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(NextImage.Bind()), tVector2(24,24), tVector2(0,0), tVector2(1,1), 2,
+			NextIcon, tVector2(24,24), true, 2,
 			ColourBG, nextAvail ? ColourEnabledTint : ColourDisabledTint) && nextAvail
 		)	OnNext();
 		ImGui::End();
@@ -1118,9 +1648,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ImGui::SetNextWindowPos(tVector2((workAreaW>>1)-22.0f+80.0f, float(topUIHeight) + float(workAreaH) - 42.0f));
 		ImGui::SetNextWindowSize(tVector2(40, 40), ImGuiCond_Always);
 		ImGui::Begin("SkipEnd", nullptr, flagsImgButton);
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(SkipEndImage.Bind()), tVector2(24,24), tVector2(0,0), tVector2(1,1), 2,
+			SkipEndIcon, tVector2(24,24), true, 2,
 			ColourBG, nextAvail ? ColourEnabledTint : ColourDisabledTint) && nextAvail
 		)	OnSkipEnd();
 		ImGui::End();
@@ -1129,8 +1659,8 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ImGui::SetNextWindowPos(tVector2((workAreaW>>1)-22.0f+120.0f, float(topUIHeight) + float(workAreaH) - 42.0f));
 		ImGui::SetNextWindowSize(tVector2(40, 40), ImGuiCond_Always);
 		ImGui::Begin("Fullscreen", nullptr, flagsImgButton);
-		uint64 fsImageID = FullscreenMode ? WindowedImage.Bind() : FullscreenImage.Bind();
-		if (ImGui::ImageButton(ImTextureID(fsImageID), tVector2(24,24), tVector2(0,0), tVector2(1,1), 2, tVector4(0,0,0,0), tVector4(1,1,1,1)))
+		const Icon& fsIcon = FullscreenMode ? WindowedIcon : FullscreenIcon;
+		if (IconButton(fsIcon, tVector2(24,24), true, 2, tVector4(0,0,0,0), tVector4(1,1,1,1)))
 			ChangeScreenMode(!FullscreenMode);
 		ImGui::End();
 	}
@@ -1264,6 +1794,7 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 					Config.ShowMenuBar = true;
 			}
 			ImGui::MenuItem("Image Details", "I", &Config.ShowImageDetails);
+			ImGui::MenuItem("Profiler", "F2", &Config.ShowProfiler);
 			ImGui::MenuItem("Content View", "V", &Config.ContentViewShow);
 
 			ImGui::Separator();
@@ -1341,9 +1872,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 			ColourCopyAs();
 
 		bool transAvail = CurrImage ? !CurrImage->IsAltPictureEnabled() : false;
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(FlipVImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2, ColourBG,
+			FlipVIcon, tVector2(17, 17), false, 2, ColourBG,
 			transAvail ? ColourEnabledTint : ColourDisabledTint) && transAvail
 		)
 		{
@@ -1354,9 +1885,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		}
 		ShowToolTip("Flip Vertically");
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(FlipHImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2, ColourBG,
+			FlipHIcon, tVector2(17, 17), false, 2, ColourBG,
 			transAvail ? ColourEnabledTint : ColourDisabledTint) && transAvail
 		)
 		{
@@ -1367,9 +1898,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		}
 		ShowToolTip("Flip Horizontally");
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(RotateACWImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2, ColourBG,
+			RotateACWIcon, tVector2(17, 17), false, 2, ColourBG,
 			transAvail ? ColourEnabledTint : ColourDisabledTint) && transAvail
 		)
 		{
@@ -1380,9 +1911,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		}
 		ShowToolTip("Rotate 90 Anticlockwise");
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(RotateCWImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2, ColourBG,
+			RotateCWIcon, tVector2(17, 17), false, 2, ColourBG,
 			transAvail ? ColourEnabledTint : ColourDisabledTint) && transAvail
 		)
 		{
@@ -1394,18 +1925,18 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ShowToolTip("Rotate 90 Clockwise");
 
 		bool cropAvail = CurrImage && transAvail && !Config.Tile;
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(CropImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			CropIcon, tVector2(17, 17), false, 2,
 			CropMode ? ColourPressedBG : ColourBG, cropAvail ? ColourEnabledTint : ColourDisabledTint) && cropAvail
 		)	CropMode = !CropMode;
 		ShowToolTip("Crop");
 
 		bool altMipmapsPicAvail = CurrImage ? CurrImage->IsAltMipmapsPictureAvail() && !CropMode : false;
 		bool altMipmapsPicEnabl = altMipmapsPicAvail && CurrImage->IsAltPictureEnabled();
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(MipmapsImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			MipmapsIcon, tVector2(17, 17), false, 2,
 			altMipmapsPicEnabl ? ColourPressedBG : ColourBG, altMipmapsPicAvail ? ColourEnabledTint : ColourDisabledTint) && altMipmapsPicAvail
 		)
 		{
@@ -1416,9 +1947,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 
 		bool altCubemapPicAvail = CurrImage ? CurrImage->IsAltCubemapPictureAvail() && !CropMode : false;
 		bool altCubemapPicEnabl = altCubemapPicAvail && CurrImage->IsAltPictureEnabled();
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(CubemapImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			CubemapIcon, tVector2(17, 17), false, 2,
 			altCubemapPicEnabl ? ColourPressedBG : ColourBG, altCubemapPicAvail ? ColourEnabledTint : ColourDisabledTint) && altCubemapPicAvail
 		)
 		{
@@ -1428,9 +1959,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ShowToolTip("Display Cubemap\nDDS files may be cubemaps.");
 
 		bool tileAvail = CurrImage ? !CropMode : false;
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(TileImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			TileIcon, tVector2(17, 17), false, 2,
 			Config.Tile ? ColourPressedBG : ColourBG, tileAvail ? ColourEnabledTint : ColourDisabledTint) && tileAvail
 		)
 		{
@@ -1441,9 +1972,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ShowToolTip("Show Images Tiled");
 
 		bool refreshAvail = CurrImage ? true : false;
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(RefreshImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			RefreshIcon, tVector2(17, 17), false, 2,
 			ColourBG, refreshAvail ? ColourEnabledTint : ColourDisabledTint) && refreshAvail
 		)
 		{
@@ -1456,30 +1987,30 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		ShowToolTip("Refresh/Reload Current File");
 
 		bool recycleAvail = CurrImage ? true : false;
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(RecycleImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			RecycleIcon, tVector2(17, 17), false, 2,
 			ColourBG, recycleAvail ? ColourEnabledTint : ColourDisabledTint) && recycleAvail
 		)	Request_DeleteFileModal = true;
 		ShowToolTip("Delete Current File");
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(ContentViewImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			ContentViewIcon, tVector2(17, 17), false, 2,
 			Config.ContentViewShow ? ColourPressedBG : ColourBG, ColourEnabledTint)
 		)	Config.ContentViewShow = !Config.ContentViewShow;
 		ShowToolTip("Content Thumbnail View");
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(PropEditImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			PropEditIcon, tVector2(17, 17), false, 2,
 			PropEditorWindow ? ColourPressedBG : ColourBG, ColourEnabledTint)
 		)	PropEditorWindow = !PropEditorWindow;
 		ShowToolTip("Image Property Editor");
 
-		if (ImGui::ImageButton
+		if (IconButton
 		(
-			ImTextureID(InfoOverlayImage.Bind()), tVector2(17, 17), tVector2(0, 1), tVector2(1, 0), 2,
+			InfoOverlayIcon, tVector2(17, 17), false, 2,
 			Config.ShowImageDetails ? ColourPressedBG : ColourBG, ColourEnabledTint)
 		)	Config.ShowImageDetails = !Config.ShowImageDetails;
 		ShowToolTip("Information Overlay");
@@ -1505,6 +2036,9 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 	if (Config.ShowImageDetails)
 		ShowImageDetailsOverlay(&Config.ShowImageDetails, 0.0f, float(topUIHeight), float(dispw), float(disph - bottomUIHeight - topUIHeight), imgx, imgy, ZoomPercent);
 
+	if (Config.ShowProfiler)
+		ShowProfilerOverlay(&Config.ShowProfiler, 0.0f, float(topUIHeight), float(dispw), float(disph - bottomUIHeight - topUIHeight));
+
 	if (Config.ContentViewShow)
 		ShowContentViewDialog(&Config.ContentViewShow);
 
@@ -1545,6 +2079,7 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 	glViewport(0, 0, dispw, disph);
 	ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
 
+	frameTimer.Stop();
 	glfwMakeContextCurrent(window);
 	glfwSwapBuffers(window);
 	FrameNumber++;
@@ -1641,6 +2176,7 @@ void Viewer::SetBasicViewAndBehaviour()
 	Config.ShowMenuBar = false;
 	Config.ShowNavBar = false;
 	Config.ShowImageDetails = false;
+	Config.ShowProfiler = false;
 	Config.AutoPropertyWindow = false;
 	Config.ContentViewShow = false;
 	Config.AutoPlayAnimatedImages = true;
@@ -1785,6 +2321,10 @@ void Viewer::KeyCallback(GLFWwindow* window, int key, int scancode, int action,
 			ShowCheatSheet = !ShowCheatSheet;
 			break;
 
+		case GLFW_KEY_F2:
+			Config.ShowProfiler = !Config.ShowProfiler;
+			break;
+
 		case GLFW_KEY_F11:
 			ChangeScreenMode(!FullscreenMode);
 			break;
@@ -1975,14 +2515,27 @@ void Viewer::FocusCallback(GLFWwindow* window, int gotFocus)
 	if (!gotFocus)
 		return;
 
+	// The watcher keeps the images in ImagesDir up to date on its own. Only platforms without one need to rescan it.
+	// It doesn't see subfolders though, and neither does the hash below, so in recursive mode they are walked again.
+	if (ImagesDirWatcher.IsWatching())
+	{
+		StartTreeScan();
+		return;
+	}
+
 	// If we got focus, rescan the current folder to see if the hash is different.
-	tList<tStringItem> files;
-	ImagesDir = FindImageFilesInCurrentFolder(files);
-	PopulateImagesSubDirs();
+	// A folder that can't be read right now keeps the images we have rather than emptying the list.
+	DirScan scan;
+	tString imagesDir;
+	if (!FindImageFilesInCurrentFolder(scan, imagesDir))
+		return;
+
+	ImagesDir = imagesDir;
+	ImagesFolders.SetRoot(ImagesDir, &GetImageExtensions());
 
 	// We sort here so ComputeImagesHash always returns consistent values.
-	files.Sort(Compare_AlphabeticalAscending, tListSortAlgorithm::Merge);
-	tuint256 hash = ComputeImagesHash(files);
+	scan.SortFiles();
+	tuint256 hash = ComputeImagesHash(scan);
 
 	if (hash != ImagesHash)
 	{
@@ -1996,6 +2549,7 @@ void Viewer::FocusCallback(GLFWwindow* window, int gotFocus)
 	else
 	{
 		tPrintf("Hash match. Dir contents same. Doing nothing.\n");
+		StartTreeScan();
 	}
 }
 
@@ -2006,100 +2560,182 @@ void Viewer::IconifyCallback(GLFWwindow* window, int iconified)
 }
 
 
-int Viewer::RemoveOldCacheFiles(const tString& cacheDir)
+int Viewer::WarmCache(const tString& cfgFile)
 {
-	tList<tStringItem> cacheFiles;
-	tSystem::tFindFiles(cacheFiles, cacheDir, "bin");
-	int numFiles = cacheFiles.NumItems();
-	if (numFiles <= Config.MaxCacheFiles)
-		return 0;
-
-	cacheFiles.Sort(Compare_FileCreationTimeAscending);
-	int targetCount = tClampMin(Config.MaxCacheFiles - 100, 0);
+	// There's no nav bar to log to so everything goes straight to the terminal. No monitor is queried in this mode
+	// and the window settings are never saved, so any screen size will do for the settings load.
+	tSystem::tSetStdoutRedirectCallback(nullptr);
+	Config.Load(cfgFile, 1920, 1080);
 
-	int numToRemove = numFiles - targetCount;
-	tAssert(numToRemove >= 0);
-	int deletedCount = 0;
-	while (numToRemove)
+	tString rootDir = tSystem::tGetCurrentDir();
+	if (ImageFileParam.IsPresent())
 	{
-		tStringItem* head = cacheFiles.Remove();
-		if (tDeleteFile(*head))
-			deletedCount++;
-		delete head;
-		numToRemove--;
+		tString param = ImageFileParam.Get();
+		if (tSystem::tDirExists(param))
+			rootDir = param;
+		else if (!tSystem::tGetDir(param).IsEmpty())
+			rootDir = tSystem::tGetDir(param);
 	}
 
-	return deletedCount;
+	// Symlinked folders are followed, so the walk still needs a depth limit. This is the deepest the settings allow.
+	const int maxDepth = 64;
+	int level = Image::GetThumbLevel(Config.ThumbnailWidth, Config.ThumbnailHiDPI);
+	Image::ThumbCache.Load(Image::ThumbCacheDir);
+	int numFailed = WarmThumbnailCache(rootDir, maxDepth, level, &GetImageExtensions());
+	Image::ThumbCache.Save();
+
+	// Nothing is evicted here. The viewer does it next run, and what was just generated is the most recently used.
+	int64 cacheMB = Image::ThumbCache.GetTotalBytes() / (1024*1024);
+	if (cacheMB > Config.MaxCacheSizeMB)
+		tPrintf("Warning: The cache is %d MB, over the %d MB allowed. The viewer trims it next run.\n", int(cacheMB), Config.MaxCacheSizeMB);
+	Image::ThumbCache.Cancel();
+
+	return (numFailed > 0) ? 1 : 0;
 }
 
 
 void Viewer::LoadAppImages(const tString& dataDir)
 {
-	ReticleImage			.Load(dataDir + "Reticle.png");
-	PrevImage				.Load(dataDir + "Prev.png");
-	NextImage				.Load(dataDir + "Next.png");
-	PrevArrowImage			.Load(dataDir + "PrevArrow.png");
-	NextArrowImage			.Load(dataDir + "NextArrow.png");
-	FlipHImage				.Load(dataDir + "FlipH.png");
-	FlipVImage				.Load(dataDir + "FlipV.png");
-	RotateACWImage			.Load(dataDir + "RotACW.png");
-	RotateCWImage			.Load(dataDir + "RotCW.png");
-	FullscreenImage			.Load(dataDir + "Fullscreen.png");
-	WindowedImage			.Load(dataDir + "Windowed.png");
-	SkipBeginImage			.Load(dataDir + "SkipBegin.png");
-	SkipEndImage			.Load(dataDir + "SkipEnd.png");
-	MipmapsImage			.Load(dataDir + "Mipmaps.png");
-	CubemapImage			.Load(dataDir + "Cubemap.png");
-	RefreshImage			.Load(dataDir + "Refresh.png");
-	RecycleImage			.Load(dataDir + "Recycle.png");
-	PropEditImage			.Load(dataDir + "PropEdit.png");
-	InfoOverlayImage		.Load(dataDir + "InfoOverlay.png");
-	TileImage				.Load(dataDir + "Tile.png");
-	StopImage				.Load(dataDir + "Stop.png");
-	StopRevImage			.Load(dataDir + "Stop.png");
-	PlayImage				.Load(dataDir + "Play.png");
-	PlayRevImage			.Load(dataDir + "PlayRev.png");
-	PlayLoopImage			.Load(dataDir + "PlayLoop.png");
-	PlayOnceImage			.Load(dataDir + "PlayOnce.png");
-	ContentViewImage		.Load(dataDir + "ContentView.png");
-	UpFolderImage			.Load(dataDir + "UpFolder.png");
-	CropImage				.Load(dataDir + "Crop.png");
-	DefaultThumbnailImage	.Load(dataDir + "DefaultThumbnail.png");
+	// All the icons live in a single atlas texture. It is cached next to the thumbnails so that after the first run
+	// this is a single file read. It doesn't use the bin extension so cache cleanup leaves it alone. The texture
+	// itself isn't created until the first frame draws an icon.
+	const IconAtlas::Entry entries[] =
+	{
+		{ &ReticleIcon,				"Reticle.png" },
+		{ &PrevIcon,				"Prev.png" },
+		{ &NextIcon,				"Next.png" },
+		{ &PrevArrowIcon,			"PrevArrow.png" },
+		{ &NextArrowIcon,			"NextArrow.png" },
+		{ &FlipHIcon,				"FlipH.png" },
+		{ &FlipVIcon,				"FlipV.png" },
+		{ &RotateACWIcon,			"RotACW.png" },
+		{ &RotateCWIcon,			"RotCW.png" },
+		{ &FullscreenIcon,			"Fullscreen.png" },
+		{ &WindowedIcon,			"Windowed.png" },
+		{ &SkipBeginIcon,			"SkipBegin.png" },
+		{ &SkipEndIcon,				"SkipEnd.png" },
+		{ &MipmapsIcon,				"Mipmaps.png" },
+		{ &CubemapIcon,				"Cubemap.png" },
+		{ &RefreshIcon,				"Refresh.png" },
+		{ &RecycleIcon,				"Recycle.png" },
+		{ &PropEditIcon,			"PropEdit.png" },
+		{ &InfoOverlayIcon,			"InfoOverlay.png" },
+		{ &TileIcon,				"Tile.png" },
+		{ &StopIcon,				"Stop.png" },
+		{ &StopRevIcon,				"Stop.png" },
+		{ &PlayIcon,				"Play.png" },
+		{ &PlayRevIcon,				"PlayRev.png" },
+		{ &PlayLoopIcon,			"PlayLoop.png" },
+		{ &PlayOnceIcon,			"PlayOnce.png" },
+		{ &ContentViewIcon,			"ContentView.png" },
+		{ &UpFolderIcon,			"UpFolder.png" },
+		{ &CropIcon,				"Crop.png" },
+		{ &DefaultThumbnailIcon,	"DefaultThumbnail.png" }
+	};
+
+	tString cacheFile = Image::ThumbCacheDir + "Icons.dat";
+	if (!Icons.Load(entries, tNumElements(entries), dataDir, cacheFile))
+		tPrintf("Warning: Failed to load all icons from %s\n", dataDir.Chars());
 }
 
 
 void Viewer::UnloadAppImages()
 {
-	ReticleImage			.Unload();
-	PrevImage				.Unload();
-	NextImage				.Unload();
-	PrevArrowImage			.Unload();
-	NextArrowImage			.Unload();
-	FlipHImage				.Unload();
-	FlipVImage				.Unload();
-	RotateACWImage			.Unload();
-	RotateCWImage			.Unload();
-	FullscreenImage			.Unload();
-	WindowedImage			.Unload();
-	SkipBeginImage			.Unload();
-	SkipEndImage			.Unload();
-	MipmapsImage			.Unload();
-	CubemapImage			.Unload();
-	RefreshImage			.Unload();
-	RecycleImage			.Unload();
-	PropEditImage			.Unload();
-	InfoOverlayImage		.Unload();
-	TileImage				.Unload();
-	StopImage				.Unload();
-	StopRevImage			.Unload();
-	PlayImage				.Unload();
-	PlayRevImage			.Unload();
-	PlayLoopImage			.Unload();
-	PlayOnceImage			.Unload();
-	ContentViewImage		.Unload();
-	UpFolderImage			.Unload();
-	CropImage				.Unload();
-	DefaultThumbnailImage	.Unload();
+	Icons.Unload();
+}
+
+
+void Viewer::LoadFont(const tString& fontFile, float sizePixels, const tString& cacheFile)
+{
+	// The cache layout is the header, then the glyphs, then the alpha-only atlas pixels.
+	struct FontCacheHeader
+	{
+		uint32 Magic;
+		tuint256 Key;
+		int32 TexWidth;
+		int32 TexHeight;
+		ImVec2 TexUvWhitePixel;
+		float FontSize;
+		float Ascent;
+		float Descent;
+		int32 MetricsTotalSurface;
+		int32 NumGlyphs;
+	};
+	const uint32 fontCacheMagic = 0x46435654;	// 'TVCF' little-endian.
+
+	int fontVersion = 1;
+	tFileInfo fileInfo;
+	tGetFileInfo(fileInfo, fontFile);
+	tuint256 key = tHashData256((uint8*)&fontVersion, sizeof(fontVersion));
+	key = tHashString256(IMGUI_VERSION, key);
+	key = tHashString256(fontFile, key);
+	key = tHashData256((uint8*)&fileInfo.FileSize, sizeof(fileInfo.FileSize), key);
+	key = tHashData256((uint8*)&fileInfo.ModificationTime, sizeof(fileInfo.ModificationTime), key);
+	key = tHashData256((uint8*)&sizePixels, sizeof(sizePixels), key);
+
+	ImFontAtlas* atlas = ImGui::GetIO().Fonts;
+	int fileSize = 0;
+	uint8* data = tFileExists(cacheFile) ? tLoadFile(cacheFile, nullptr, &fileSize) : nullptr;
+	const FontCacheHeader* header = (const FontCacheHeader*)data;
+	if
+	(
+		data && (fileSize >= int(sizeof(FontCacheHeader))) && (header->Magic == fontCacheMagic) && (header->Key == key) &&
+		(fileSize == int(sizeof(FontCacheHeader)) + header->NumGlyphs*int(sizeof(ImFontGlyph)) + header->TexWidth*header->TexHeight)
+	)
+	{
+		// Rebuild the font exactly as ImFontAtlas::Build would have left it. With the alpha pixels present the atlas
+		// reports itself as built and the renderer never calls into stb_truetype.
+		ImFont* font = IM_NEW(ImFont);
+		font->FontSize = header->FontSize;
+		font->Ascent = header->Ascent;
+		font->Descent = header->Descent;
+		font->MetricsTotalSurface = header->MetricsTotalSurface;
+		font->ContainerAtlas = atlas;
+		const ImFontGlyph* glyphs = (const ImFontGlyph*)(data + sizeof(FontCacheHeader));
+		font->Glyphs.resize(header->NumGlyphs);
+		tMemcpy(font->Glyphs.Data, glyphs, header->NumGlyphs*sizeof(ImFontGlyph));
+		font->BuildLookupTable();
+		atlas->Fonts.push_back(font);
+
+		int numPixels = header->TexWidth*header->TexHeight;
+		atlas->TexPixelsAlpha8 = (unsigned char*)ImGui::MemAlloc(numPixels);
+		tMemcpy(atlas->TexPixelsAlpha8, (uint8*)(glyphs + header->NumGlyphs), numPixels);
+		atlas->TexWidth = header->TexWidth;
+		atlas->TexHeight = header->TexHeight;
+		atlas->TexUvScale = ImVec2(1.0f/float(header->TexWidth), 1.0f/float(header->TexHeight));
+		atlas->TexUvWhitePixel = header->TexUvWhitePixel;
+		delete[] data;
+		return;
+	}
+	delete[] data;
+
+	// Cache miss. We build the atlas now rather than letting the renderer do it on the first frame, so we can save it.
+	ImFont* font = atlas->AddFontFromFileTTF(fontFile.Chars(), sizePixels);
+	unsigned char* pixels = nullptr;
+	int texWidth = 0, texHeight = 0;
+	atlas->GetTexDataAsAlpha8(&pixels, &texWidth, &texHeight);
+	if (!font || !pixels)
+		return;
+
+	int glyphsSize = font->Glyphs.Size*sizeof(ImFontGlyph);
+	fileSize = sizeof(FontCacheHeader) + glyphsSize + texWidth*texHeight;
+	data = new uint8[fileSize];
+	FontCacheHeader* newHeader = (FontCacheHeader*)data;
+	newHeader->Magic = fontCacheMagic;
+	newHeader->Key = key;
+	newHeader->TexWidth = texWidth;
+	newHeader->TexHeight = texHeight;
+	newHeader->TexUvWhitePixel = atlas->TexUvWhitePixel;
+	newHeader->FontSize = font->FontSize;
+	newHeader->Ascent = font->Ascent;
+	newHeader->Descent = font->Descent;
+	newHeader->MetricsTotalSurface = font->MetricsTotalSurface;
+	newHeader->NumGlyphs = font->Glyphs.Size;
+	tMemcpy(data + sizeof(FontCacheHeader), font->Glyphs.Data, glyphsSize);
+	tMemcpy(data + sizeof(FontCacheHeader) + glyphsSize, pixels, texWidth*texHeight);
+	if (!tCreateFile(cacheFile, data, fileSize))
+		tPrintf("Warning: Unable to write font cache %s\n", cacheFile.Chars());
+	delete[] data;
 }
 
 
@@ -2131,22 +2767,6 @@ int main(int argc, char** argv)
 	tPrintf("LD_LIBRARY_PATH  : %s\n", ldLibraryPath.Chars());
 	#endif
 
-	// Setup window
-	glfwSetErrorCallback(Viewer::GlfwErrorCallback);
-	if (!glfwInit())
-		return 1;
-
-	int glfwMajor = 0; int glfwMinor = 0; int glfwRev = 0;
-	glfwGetVersion(&glfwMajor, &glfwMinor, &glfwRev);
-
-	tPrintf("Tacent View V %d.%d.%d\n", ViewerVersion::Major, ViewerVersion::Minor, ViewerVersion::Revision);
-	tPrintf("Tacent Library V %d.%d.%d\n", tVersion::Major, tVersion::Minor, tVersion::Revision);
-	tPrintf("Dear ImGui V %s\n", IMGUI_VERSION);
-	tPrintf("GLFW V %d.%d.%d\n", glfwMajor, glfwMinor, glfwRev);
-
-	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
-	const GLFWvidmode* mode = glfwGetVideoMode(monitor);
-
 	#ifdef PLATFORM_WINDOWS
 	tString dataDir = tSystem::tGetProgramDir() + "Data/";
 	Image::ThumbCacheDir = dataDir + "Cache/";
@@ -2176,7 +2796,27 @@ int main(int argc, char** argv)
 
 	if (!tSystem::tDirExists(Image::ThumbCacheDir))
 		tSystem::tCreateDir(Image::ThumbCacheDir);
-	
+
+	// Cache warming runs before glfw is initialized so it works on machines without a display.
+	if (Viewer::WarmCacheOption.IsPresent())
+		return Viewer::WarmCache(cfgFile);
+
+	// Setup window
+	glfwSetErrorCallback(Viewer::GlfwErrorCallback);
+	if (!glfwInit())
+		return 1;
+
+	int glfwMajor = 0; int glfwMinor = 0; int glfwRev = 0;
+	glfwGetVersion(&glfwMajor, &glfwMinor, &glfwRev);
+
+	tPrintf("Tacent View V %d.%d.%d\n", ViewerVersion::Major, ViewerVersion::Minor, ViewerVersion::Revision);
+	tPrintf("Tacent Library V %d.%d.%d\n", tVersion::Major, tVersion::Minor, tVersion::Revision);
+	tPrintf("Dear ImGui V %s\n", IMGUI_VERSION);
+	tPrintf("GLFW V %d.%d.%d\n", glfwMajor, glfwMinor, glfwRev);
+
+	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+	const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+
 	Viewer::Config.Load(cfgFile, mode->width, mode->height);
 
 	// We start with window invisible. For windows DwmSetWindowAttribute won't redraw properly otherwise.
@@ -2281,9 +2921,12 @@ int main(int argc, char** argv)
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	tString fontFile = dataDir + "Roboto-Medium.ttf";
-	io.Fonts->AddFontFromFileTTF(fontFile.Chars(), 14.0f);
+	Viewer::LoadFont(fontFile, 14.0f, Image::ThumbCacheDir + "Font.dat");
 
 	Viewer::LoadAppImages(dataDir);
+	tString headerCacheFile = Image::ThumbCacheDir + "Headers.dat";
+	Viewer::ImagesHeaderCache.Load(headerCacheFile);
+	Image::ThumbCache.Load(Image::ThumbCacheDir);
 	
 	Viewer::PopulateImages();
 	if (Viewer::ImageFileParam.IsPresent())
@@ -2326,7 +2969,13 @@ int main(int argc, char** argv)
 
 	// This is important. We need the destructors to run BEFORE we shutdown GLFW. Deconstructing the images may block for a bit while shutting
 	// down worker threads. We could show a 'shutting down' popup here if we wanted -- if Image::ThumbnailNumThreadsRunning is > 0.
-	Viewer::Images.Clear();
+	Viewer::ImagesDirWatcher.Stop();
+	Viewer::ImagesTreeScanner.Cancel();
+	Viewer::ImagesFolders.Cancel();
+	Viewer::ClearImages();
+	Viewer::ImagesHeaderCache.Save(headerCacheFile);
+	Image::ThumbCache.Save();
+	Image::ThumbAtlas.Clear();
 	
 	Viewer::UnloadAppImages();
 
@@ -2346,10 +2995,10 @@ int main(int argc, char** argv)
 	glfwDestroyWindow(Viewer::Window);
 	glfwTerminate();
 
-	// Before we go, lets clear out any old cache files.
+	// Old thumbnails are evicted in the background while we run so there's nothing to trim here. Any eviction still
+	// going is just abandoned. Files it deletes after the index was saved are dropped from it next run.
+	Image::ThumbCache.Cancel();
 	if (Viewer::DeleteAllCacheFilesOnExit)
 		tSystem::tDeleteDir(Image::ThumbCacheDir);
-	else
-		Viewer::RemoveOldCacheFiles(Image::ThumbCacheDir);
 	return 0;
 }
@@ -17,7 +17,9 @@
 #include <Math/tVector4.h>
 #include <System/tCommand.h>
 #include "Settings.h"
+#include "FolderTree.h"
 class Image;
+struct Icon;
 class tColouri;
 
 
@@ -26,23 +28,23 @@ namespace Viewer
 	extern Settings Config;
 	extern Image* CurrImage;
 	extern tString ImagesDir;
-	extern tList<tStringItem> ImagesSubDirs;
+	extern FolderTree ImagesFolders;
 	extern tList<Image> Images;
-	extern tItList<Image> ImagesLoadTimeSorted;
+	extern uint32 ImagesVersion;			// Changes whenever Images is added to, removed from, or reordered.
 	extern tCommand::tParam ImageFileParam;
 	extern tColouri PixelColour;
-	extern Image DefaultThumbnailImage;
-	extern Image UpFolderImage;
-	extern Image PlayImage;
-	extern Image PlayRevImage;
-	extern Image StopImage;
-	extern Image StopRevImage;
-	extern Image PlayLoopImage;
-	extern Image PlayOnceImage;
-	extern Image PrevImage;
-	extern Image NextImage;
-	extern Image SkipBeginImage;
-	extern Image SkipEndImage;
+	extern Icon DefaultThumbnailIcon;
+	extern Icon UpFolderIcon;
+	extern Icon PlayIcon;
+	extern Icon PlayRevIcon;
+	extern Icon StopIcon;
+	extern Icon StopRevIcon;
+	extern Icon PlayLoopIcon;
+	extern Icon PlayOnceIcon;
+	extern Icon PrevIcon;
+	extern Icon NextIcon;
+	extern Icon SkipBeginIcon;
+	extern Icon SkipEndIcon;
 	extern bool CropMode;
 	extern bool DeleteAllCacheFilesOnExit;
 
@@ -60,9 +62,24 @@ namespace Viewer
 	// Helper to display a little (?) mark which shows a tooltip when hovered.
 	void ShowHelpMark(const char* desc);
 	void ShowToolTip(const char* desc);
+
+	// Use instead of ImGui::ImageButton for icons. The uvs are flipped vertically if flipV is true.
+	bool IconButton
+	(
+		const Icon&, const tMath::tVector2& size, bool flipV, int framePadding,
+		const tMath::tVector4& bgCol, const tMath::tVector4& tintCol
+	);
 	void PopulateImages();
 	void PopulateImagesSubDirs();
 	Image* FindImage(const tString& filename);
+
+	// Always use these to modify Images. They keep the lookup indexes and ImagesLoadTimeSorted in step.
+	// AddImage does not check if the image is already present. Unless they're passed in, the file mod time and size are
+	// fetched in the background.
+	Image* AddImage(const tString& filename);
+	Image* AddImage(const tString& filename, std::time_t modTime, uint64 fileSize);
+	void RemoveImage(Image*);
+	void ClearImages();
 	void SetCurrentImage(const tString& currFilename = tString());
 	void LoadCurrImage();
 	bool ChangeScreenMode(bool fullscreeen, bool force = false);
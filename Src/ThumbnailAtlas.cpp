@@ -0,0 +1,308 @@
+// ThumbnailAtlas.cpp
+//
+// Packs thumbnails into a small number of large textures so the content view can draw them in a few batches.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <glad/glad.h>
+#include <Math/tFundamentals.h>
+#include "ThumbnailAtlas.h"
+using namespace tMath;
+using namespace tImage;
+
+
+const int ThumbnailAtlas::MaxPageSize = 2048;
+
+
+ThumbnailAtlas::Page::Page(int slotW, int slotH, int pageSize) :
+	SlotW(slotW),
+	SlotH(slotH),
+	PageSize(pageSize)
+{
+	// Each slot has a one pixel gutter on every side so bilinear filtering never reads a neighbour.
+	Cols = PageSize / (SlotW + 2);
+	Rows = PageSize / (SlotH + 2);
+	int numSlots = GetNumSlots();
+	if (numSlots <= 0)
+		return;
+
+	Generations = new uint32[numSlots];
+	LastUsed = new uint64[numSlots];
+	tMemset(Generations, 0, numSlots*sizeof(uint32));
+	tMemset(LastUsed, 0, numSlots*sizeof(uint64));
+
+	glGenTextures(1, &TexID);
+	if (TexID == 0)
+		return;
+
+	glBindTexture(GL_TEXTURE_2D, TexID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PageSize, PageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+
+ThumbnailAtlas::Page::~Page()
+{
+	if (TexID != 0)
+		glDeleteTextures(1, &TexID);
+	delete[] Generations;
+	delete[] LastUsed;
+}
+
+
+ThumbnailAtlas::~ThumbnailAtlas()
+{
+	// By the time static objects are destroyed the GL context is gone. Clear should have been called already. If it
+	// wasn't there is nothing we can safely do with the texture IDs.
+	for (int p = 0; p < MaxPages; p++)
+	{
+		if (!Pages[p])
+			continue;
+		Pages[p]->TexID = 0;
+		delete Pages[p];
+		Pages[p] = nullptr;
+	}
+}
+
+
+void ThumbnailAtlas::Clear()
+{
+	for (int p = 0; p < MaxPages; p++)
+		DestroyPage(p);
+}
+
+
+int ThumbnailAtlas::CreatePage(int slotW, int slotH)
+{
+	int pageIndex = -1;
+	for (int p = 0; p < MaxPages; p++)
+	{
+		if (!Pages[p])
+		{
+			pageIndex = p;
+			break;
+		}
+	}
+	if (pageIndex == -1)
+		return -1;
+
+	GLint maxTexSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+	int pageSize = tMin(MaxPageSize, int(maxTexSize));
+
+	Page* page = new Page(slotW, slotH, pageSize);
+	if ((page->TexID == 0) || (page->GetNumSlots() <= 0))
+	{
+		delete page;
+		return -1;
+	}
+
+	Pages[pageIndex] = page;
+	return pageIndex;
+}
+
+
+void ThumbnailAtlas::DestroyPage(int pageIndex)
+{
+	delete Pages[pageIndex];
+	Pages[pageIndex] = nullptr;
+}
+
+
+void ThumbnailAtlas::Assign(Slot& slot, int pageIndex, int slotIndex)
+{
+	Page* page = Pages[pageIndex];
+	if (NextGeneration == 0)
+		NextGeneration++;
+
+	if (page->Generations[slotIndex] == 0)
+		page->NumUsed++;
+	page->Generations[slotIndex] = NextGeneration;
+	page->LastUsed[slotIndex] = FrameNumber;
+
+	slot.Page = pageIndex;
+	slot.Index = slotIndex;
+	slot.Generation = NextGeneration++;
+}
+
+
+bool ThumbnailAtlas::Alloc(Slot& slot, int width, int height)
+{
+	Free(slot);
+
+	// First look for a free slot in an existing page of the right size.
+	for (int p = 0; p < MaxPages; p++)
+	{
+		Page* page = Pages[p];
+		if (!page || (page->SlotW != width) || (page->SlotH != height) || (page->NumUsed >= page->GetNumSlots()))
+			continue;
+
+		for (int s = 0; s < page->GetNumSlots(); s++)
+		{
+			if (page->Generations[s] == 0)
+			{
+				Assign(slot, p, s);
+				return true;
+			}
+		}
+	}
+
+	// Next try a new page. If we're at the page limit, an empty page of a different slot size may be recycled.
+	int newPage = CreatePage(width, height);
+	if (newPage == -1)
+	{
+		for (int p = 0; p < MaxPages; p++)
+		{
+			if (Pages[p] && (Pages[p]->NumUsed == 0))
+			{
+				DestroyPage(p);
+				newPage = CreatePage(width, height);
+				break;
+			}
+		}
+	}
+	if (newPage != -1)
+	{
+		Assign(slot, newPage, 0);
+		return true;
+	}
+
+	// Finally evict. The least recently used slot of the right size competes with whole pages of other sizes, such as
+	// those left over from a different thumbnail size. Slots in other sized pages are never freed on their own, so
+	// without this the pages could all be stuck holding a size nobody draws any more. Anything drawn this frame is
+	// off limits.
+	int lruPage = -1;
+	int lruSlot = -1;
+	uint64 lruFrame = FrameNumber;
+	for (int p = 0; p < MaxPages; p++)
+	{
+		Page* page = Pages[p];
+		if (!page || (page->SlotW != width) || (page->SlotH != height))
+			continue;
+
+		for (int s = 0; s < page->GetNumSlots(); s++)
+		{
+			if (page->LastUsed[s] < lruFrame)
+			{
+				lruFrame = page->LastUsed[s];
+				lruPage = p;
+				lruSlot = s;
+			}
+		}
+	}
+
+	// A page goes if even its most recently drawn slot is older than the slot we'd otherwise take.
+	int stalePage = -1;
+	uint64 staleFrame = lruFrame;
+	for (int p = 0; p < MaxPages; p++)
+	{
+		Page* page = Pages[p];
+		if (!page || ((page->SlotW == width) && (page->SlotH == height)))
+			continue;
+
+		uint64 newestFrame = 0;
+		for (int s = 0; s < page->GetNumSlots(); s++)
+			newestFrame = tMax(newestFrame, page->LastUsed[s]);
+		if (newestFrame < staleFrame)
+		{
+			staleFrame = newestFrame;
+			stalePage = p;
+		}
+	}
+
+	// The old owners' handles stop being resident since their generations never come back.
+	if (stalePage != -1)
+	{
+		DestroyPage(stalePage);
+		newPage = CreatePage(width, height);
+		if (newPage != -1)
+		{
+			Assign(slot, newPage, 0);
+			return true;
+		}
+	}
+
+	if (lruPage == -1)
+		return false;
+
+	// Giving the slot a new generation invalidates the previous owner's handle.
+	Assign(slot, lruPage, lruSlot);
+	return true;
+}
+
+
+void ThumbnailAtlas::Free(Slot& slot)
+{
+	if (IsResident(slot))
+	{
+		Page* page = Pages[slot.Page];
+		page->Generations[slot.Index] = 0;
+		page->LastUsed[slot.Index] = 0;
+		page->NumUsed--;
+	}
+
+	slot = Slot();
+}
+
+
+bool ThumbnailAtlas::IsResident(const Slot& slot) const
+{
+	if ((slot.Page < 0) || (slot.Page >= MaxPages) || !Pages[slot.Page] || (slot.Generation == 0))
+		return false;
+
+	return Pages[slot.Page]->Generations[slot.Index] == slot.Generation;
+}
+
+
+bool ThumbnailAtlas::Upload(const Slot& slot, const tPicture& picture)
+{
+	if (!IsResident(slot) || !picture.IsValid())
+		return false;
+
+	Page* page = Pages[slot.Page];
+	if ((picture.GetWidth() != page->SlotW) || (picture.GetHeight() != page->SlotH))
+		return false;
+
+	int x = (slot.Index % page->Cols) * (page->SlotW + 2) + 1;
+	int y = (slot.Index / page->Cols) * (page->SlotH + 2) + 1;
+	glBindTexture(GL_TEXTURE_2D, page->TexID);
+	glTexSubImage2D
+	(
+		GL_TEXTURE_2D, 0, x, y, page->SlotW, page->SlotH,
+		GL_RGBA, GL_UNSIGNED_BYTE, picture.GetPixelPointer()
+	);
+	return true;
+}
+
+
+uint64 ThumbnailAtlas::Touch(const Slot& slot, tVector2& uv0, tVector2& uv1)
+{
+	if (!IsResident(slot))
+		return 0;
+
+	Page* page = Pages[slot.Page];
+	page->LastUsed[slot.Index] = FrameNumber;
+
+	// We inset by half a texel so bilinear filtering stays inside the slot. The v coords are swapped because
+	// pictures are stored bottom-up while ImGui expects the top-left corner first.
+	float size = float(page->PageSize);
+	float x = float((slot.Index % page->Cols) * (page->SlotW + 2) + 1);
+	float y = float((slot.Index / page->Cols) * (page->SlotH + 2) + 1);
+	uv0.u = (x + 0.5f) / size;
+	uv1.u = (x + float(page->SlotW) - 0.5f) / size;
+	uv0.v = (y + float(page->SlotH) - 0.5f) / size;
+	uv1.v = (y + 0.5f) / size;
+
+	return page->TexID;
+}
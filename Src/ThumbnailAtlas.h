@@ -0,0 +1,84 @@
+// ThumbnailAtlas.h
+//
+// Packs thumbnails into a small number of large textures so the content view can draw them in a few batches.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Math/tVector2.h>
+#include <Image/tPicture.h>
+
+
+// A slab allocator for thumbnail textures. Each page is a single GL texture divided into equal sized slots. A page only
+// ever holds one slot size and pages are created on demand up to MaxPages. When no slot is free, the least recently
+// used slot that was not drawn during the current frame is evicted, or a whole page of another size if none of its
+// slots were drawn more recently. Owners keep a Slot handle and call IsResident to find out if it was evicted, in which
+// case they just allocate and upload again.
+class ThumbnailAtlas
+{
+public:
+	ThumbnailAtlas()																									{ }
+	~ThumbnailAtlas();
+
+	struct Slot
+	{
+		int Page			= -1;
+		int Index			= -1;
+		uint32 Generation	= 0;
+	};
+
+	// Call once per frame before any thumbnails are bound. Slots touched during the current frame are never evicted.
+	void NewFrame()																										{ FrameNumber++; }
+
+	// Returns false if no slot could be found. This happens if every slot was drawn this frame.
+	bool Alloc(Slot&, int width, int height);
+	void Free(Slot&);
+	bool IsResident(const Slot&) const;
+
+	// The picture dimensions must match the dimensions the slot was allocated with.
+	bool Upload(const Slot&, const tImage::tPicture&);
+
+	// Marks the slot as used this frame and returns the page texture ID. The uvs are for the top-left and bottom-right
+	// corners and may be passed directly to ImGui. Returns 0 if the slot is not resident.
+	uint64 Touch(const Slot&, tMath::tVector2& uv0, tMath::tVector2& uv1);
+
+	// Frees all GL textures. There must be a current GL context.
+	void Clear();
+
+	const static int MaxPages			= 8;
+	const static int MaxPageSize;		// = 2048;
+
+private:
+	struct Page
+	{
+		Page(int slotW, int slotH, int pageSize);
+		~Page();
+		uint TexID			= 0;
+		int SlotW			= 0;
+		int SlotH			= 0;
+		int PageSize		= 0;
+		int Cols			= 0;
+		int Rows			= 0;
+		int NumUsed			= 0;
+		uint32* Generations	= nullptr;		// Zero means the slot is free.
+		uint64* LastUsed	= nullptr;		// Frame number the slot was last drawn.
+
+		int GetNumSlots() const																							{ return Cols*Rows; }
+	};
+
+	int CreatePage(int slotW, int slotH);	// Returns the page index or -1.
+	void DestroyPage(int pageIndex);
+	void Assign(Slot&, int pageIndex, int slotIndex);
+
+	Page* Pages[MaxPages]				= { };
+	uint64 FrameNumber					= 1;
+	uint32 NextGeneration				= 1;
+};
@@ -0,0 +1,336 @@
+// ThumbnailCache.cpp
+//
+// Keeps the thumbnail cache folder under a byte budget by deleting the least recently used thumbnail files.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <ctime>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <System/tFile.h>
+#include <Math/tHash.h>
+#include "ThumbnailCache.h"
+using namespace tSystem;
+
+
+const int ThumbnailCache::EvictBatchSize = 256;
+const int ThumbnailCache::EvictTargetPercent = 90;
+
+
+namespace
+{
+	// Layout of the index file. The header is followed by the records.
+	struct IndexHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		int32 NumRecords;
+		int32 Pad;
+	};
+	struct IndexRecord
+	{
+		char Name[ThumbnailCache::MaxNameLength+1];
+		int64 NumBytes;
+		int64 LastUsed;
+	};
+	const uint32 IndexMagic = 0x43545654;		// 'TVTC' little-endian.
+	const uint32 IndexVersion = 1;
+	const char* IndexFileName = "Thumbnails.dat";
+}
+
+
+uint64 ThumbnailCache::ComputeKey(const tString& name)
+{
+	return tMath::tHashString64(name.Chars());
+}
+
+
+bool ThumbnailCache::Load(const tString& cacheDir)
+{
+	Cancel();
+	Current = std::make_shared<State>();
+	Current->Dir = cacheDir;
+
+	bool ok = false;
+	tString indexFile = cacheDir + IndexFileName;
+	int fileSize = 0;
+	uint8* data = tFileExists(indexFile) ? tLoadFile(indexFile, nullptr, &fileSize) : nullptr;
+	const IndexHeader* header = (const IndexHeader*)data;
+	if
+	(
+		data && (fileSize >= int(sizeof(IndexHeader))) && (header->Magic == IndexMagic) &&
+		(header->Version == IndexVersion) && (header->NumRecords >= 0) &&
+		(int64(fileSize) == int64(sizeof(IndexHeader)) + int64(header->NumRecords)*int64(sizeof(IndexRecord)))
+	)
+	{
+		const IndexRecord* records = (const IndexRecord*)(data + sizeof(IndexHeader));
+		Current->Records.reserve(header->NumRecords);
+		for (int r = 0; r < header->NumRecords; r++)
+		{
+			Record& record = Current->Records[ComputeKey(records[r].Name)];
+			tMemcpy(record.Name, records[r].Name, sizeof(record.Name));
+			record.Name[MaxNameLength] = '\0';
+			record.NumBytes = records[r].NumBytes;
+			record.LastUsed = records[r].LastUsed;
+			Current->TotalBytes += record.NumBytes;
+		}
+		ok = true;
+	}
+	delete[] data;
+
+	// The index may be stale if the last run didn't exit cleanly, so it's always checked against the folder.
+	Current->Busy = true;
+	std::thread(Reconcile, Current).detach();
+	return ok;
+}
+
+
+bool ThumbnailCache::Save()
+{
+	if (!Current)
+		return false;
+
+	uint8* data = nullptr;
+	int fileSize = 0;
+	{
+		std::lock_guard<std::mutex> lock(Current->Mutex);
+		if (!Current->Dirty)
+			return true;
+
+		int numRecords = int(Current->Records.size());
+		fileSize = sizeof(IndexHeader) + numRecords*sizeof(IndexRecord);
+		data = new uint8[fileSize];
+		tMemset(data, 0, fileSize);
+		IndexHeader* header = (IndexHeader*)data;
+		header->Magic = IndexMagic;
+		header->Version = IndexVersion;
+		header->NumRecords = numRecords;
+		IndexRecord* record = (IndexRecord*)(data + sizeof(IndexHeader));
+		for (const auto& keyRecord : Current->Records)
+		{
+			tMemcpy(record->Name, keyRecord.second.Name, sizeof(record->Name));
+			record->NumBytes = keyRecord.second.NumBytes;
+			record->LastUsed = keyRecord.second.LastUsed;
+			record++;
+		}
+		Current->Dirty = false;
+	}
+
+	bool ok = tCreateFile(Current->Dir + IndexFileName, data, fileSize);
+	if (!ok)
+	{
+		tPrintf("Warning: Unable to write thumbnail cache index in %s\n", Current->Dir.Chars());
+		std::lock_guard<std::mutex> lock(Current->Mutex);
+		Current->Dirty = true;
+	}
+	delete[] data;
+	return ok;
+}
+
+
+void ThumbnailCache::Cancel()
+{
+	if (!Current)
+		return;
+
+	Current->Cancelled = true;
+	Current.reset();
+}
+
+
+void ThumbnailCache::Touch(const tString& file)
+{
+	if (!Current)
+		return;
+
+	tString name = tGetFileName(file);
+	std::lock_guard<std::mutex> lock(Current->Mutex);
+	auto found = Current->Records.find(ComputeKey(name));
+	if (found == Current->Records.end())
+		return;
+
+	found->second.LastUsed = int64(std::time(nullptr));
+	Current->Dirty = true;
+}
+
+
+void ThumbnailCache::Add(const tString& file, int64 numBytes)
+{
+	tString name = tGetFileName(file);
+	if (!Current || (name.Length() > MaxNameLength))
+		return;
+
+	std::lock_guard<std::mutex> lock(Current->Mutex);
+	Record& record = Current->Records[ComputeKey(name)];
+	if (record.Name[0] == '\0')
+		tStd::tStrcpy(record.Name, name.Chars());
+	else
+		Current->TotalBytes -= record.NumBytes;
+
+	record.NumBytes = numBytes;
+	record.LastUsed = int64(std::time(nullptr));
+	Current->TotalBytes += numBytes;
+	Current->Dirty = true;
+}
+
+
+void ThumbnailCache::Update(int64 budgetBytes)
+{
+	if (!Current)
+		return;
+
+	std::lock_guard<std::mutex> lock(Current->Mutex);
+	if (Current->Busy || (Current->TotalBytes <= budgetBytes))
+		return;
+
+	Current->Busy = true;
+	std::thread(Evict, Current, budgetBytes / 100 * EvictTargetPercent).detach();
+}
+
+
+int64 ThumbnailCache::GetTotalBytes() const
+{
+	if (!Current)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(Current->Mutex);
+	return Current->TotalBytes;
+}
+
+
+int ThumbnailCache::GetNumFiles() const
+{
+	if (!Current)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(Current->Mutex);
+	return int(Current->Records.size());
+}
+
+
+void ThumbnailCache::Reconcile(std::shared_ptr<State> state)
+{
+	// Anything added after this point is known to exist even if the listing below missed it.
+	int64 startTime = int64(std::time(nullptr));
+	tList<tStringItem> files;
+	tFindFiles(files, state->Dir, "bin");
+
+	std::unordered_set<uint64> present;
+	present.reserve(files.NumItems());
+	tList<tStringItem> unknown;
+	{
+		std::lock_guard<std::mutex> lock(state->Mutex);
+		while (!files.IsEmpty())
+		{
+			tStringItem* file = files.Remove();
+			uint64 key = ComputeKey(tGetFileName(*file));
+			present.insert(key);
+			if (state->Records.find(key) == state->Records.end())
+				unknown.Append(file);
+			else
+				delete file;
+		}
+
+		for (auto record = state->Records.begin(); record != state->Records.end(); )
+		{
+			if ((record->second.LastUsed < startTime) && (present.find(record->first) == present.end()))
+			{
+				state->TotalBytes -= record->second.NumBytes;
+				record = state->Records.erase(record);
+				state->Dirty = true;
+			}
+			else
+			{
+				record++;
+			}
+		}
+	}
+
+	// Files the index doesn't know about need a stat for their size, which is done without holding the lock.
+	while (!unknown.IsEmpty() && !state->Cancelled)
+	{
+		tStringItem* file = unknown.Remove();
+		tString name = tGetFileName(*file);
+		tFileInfo info;
+		if ((name.Length() <= MaxNameLength) && tGetFileInfo(info, *file))
+		{
+			std::lock_guard<std::mutex> lock(state->Mutex);
+			Record& record = state->Records[ComputeKey(name)];
+			if (record.Name[0] == '\0')
+			{
+				tStd::tStrcpy(record.Name, name.Chars());
+				record.NumBytes = int64(info.FileSize);
+				record.LastUsed = int64(info.ModificationTime);
+				state->TotalBytes += record.NumBytes;
+				state->Dirty = true;
+			}
+		}
+		delete file;
+	}
+
+	std::lock_guard<std::mutex> lock(state->Mutex);
+	state->Busy = false;
+}
+
+
+void ThumbnailCache::Evict(std::shared_ptr<State> state, int64 targetBytes)
+{
+	struct Victim
+	{
+		uint64 Key;
+		int64 LastUsed;
+	};
+	std::vector<Victim> victims;
+	std::vector<tString> names;
+
+	while (!state->Cancelled)
+	{
+		// The oldest batch is taken out of the index under the lock. The files are deleted after it's released so
+		// thumbnail workers are never held up by the disk.
+		names.clear();
+		{
+			std::lock_guard<std::mutex> lock(state->Mutex);
+			if (state->TotalBytes <= targetBytes)
+				break;
+
+			victims.clear();
+			victims.reserve(state->Records.size());
+			for (const auto& keyRecord : state->Records)
+				victims.push_back({ keyRecord.first, keyRecord.second.LastUsed });
+
+			int batchSize = tMath::tMin(EvictBatchSize, int(victims.size()));
+			if (batchSize == 0)
+				break;
+			std::nth_element
+			(
+				victims.begin(), victims.begin() + (batchSize-1), victims.end(),
+				[](const Victim& a, const Victim& b) { return a.LastUsed < b.LastUsed; }
+			);
+
+			for (int v = 0; (v < batchSize) && (state->TotalBytes > targetBytes); v++)
+			{
+				auto found = state->Records.find(victims[v].Key);
+				names.push_back(found->second.Name);
+				state->TotalBytes -= found->second.NumBytes;
+				state->Records.erase(found);
+			}
+			state->Dirty = true;
+		}
+
+		for (const tString& name : names)
+			tDeleteFile(state->Dir + name);
+	}
+
+	std::lock_guard<std::mutex> lock(state->Mutex);
+	state->Busy = false;
+}
@@ -0,0 +1,86 @@
+// ThumbnailCache.h
+//
+// Keeps the thumbnail cache folder under a byte budget by deleting the least recently used thumbnail files.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <Foundation/tString.h>
+
+
+// The size and last access time of every thumbnail file are kept in a small index file in the cache folder. Access
+// times are not taken from the filesystem as many systems don't update them on read. Thumbnails are read and written
+// on worker threads so every call is thread safe. Reconciling the index with the folder and evicting files both happen
+// on a background worker, so nothing here ever blocks for long.
+class ThumbnailCache
+{
+public:
+	ThumbnailCache()																									{ }
+	~ThumbnailCache()																									{ Cancel(); }
+
+	// Load replaces the contents with the index in cacheDir, then starts a worker that adds any thumbnail files the
+	// index doesn't know about (using their mod time as the last access) and drops records whose file is gone. A
+	// missing or damaged index just means everything is found that way.
+	bool Load(const tString& cacheDir);
+
+	// Only writes if something changed. Just the index is written so this is quick.
+	bool Save();
+
+	// Stops any background work and lets go of the index, so call Save first. Files already evicted stay deleted.
+	void Cancel();
+
+	// Call when a thumbnail file is read or written. Neither touches the disk.
+	void Touch(const tString& file);
+	void Add(const tString& file, int64 numBytes);
+
+	// Call every so often. When the total is over budgetBytes and no worker is running, one is started that deletes
+	// the least recently used files, a batch at a time, until the total is at EvictTargetPercent of the budget.
+	void Update(int64 budgetBytes);
+
+	int64 GetTotalBytes() const;
+	int GetNumFiles() const;
+
+	const static int EvictBatchSize;		// = 256;
+	const static int EvictTargetPercent;	// = 90;
+	const static int MaxNameLength		= 71;
+
+private:
+	ThumbnailCache(const ThumbnailCache&) = delete;
+	ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+	struct Record
+	{
+		char Name[MaxNameLength+1];		// Of the file within the cache dir.
+		int64 NumBytes;
+		int64 LastUsed;					// Seconds since 1970.
+	};
+
+	// Shared with the worker so a cancelled worker can finish up on its own.
+	struct State
+	{
+		std::mutex Mutex;
+		tString Dir;
+		std::unordered_map<uint64, Record> Records;
+		int64 TotalBytes					= 0;
+		bool Dirty							= false;
+		bool Busy							= false;		// A worker is running.
+		std::atomic<bool> Cancelled			{ false };
+	};
+	static uint64 ComputeKey(const tString& name);
+	static void Reconcile(std::shared_ptr<State>);
+	static void Evict(std::shared_ptr<State>, int64 targetBytes);
+
+	std::shared_ptr<State> Current;
+};
@@ -0,0 +1,242 @@
+// ThumbnailCodec.cpp
+//
+// Lossless compression for cached thumbnails. The format follows QOI, which decodes in a single pass with no tables
+// beyond a 64 entry colour cache.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <System/tFile.h>
+#include "ThumbnailCodec.h"
+using namespace tSystem;
+using namespace tImage;
+
+
+const int ThumbnailCodec::MaxDimension = 4096;
+
+
+namespace ThumbnailCodec
+{
+	// Each op starts with a tag. The two bit tags carry their payload in the low six bits. The two eight bit tags
+	// overlap the run tag, which is why runs stop at 62.
+	const uint8 OpIndex		= 0x00;
+	const uint8 OpDiff		= 0x40;
+	const uint8 OpLuma		= 0x80;
+	const uint8 OpRun		= 0xC0;
+	const uint8 OpRGB		= 0xFE;
+	const uint8 OpRGBA		= 0xFF;
+	const uint8 OpMask		= 0xC0;
+	const int MaxRun		= 62;
+
+	struct FileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		int32 Width;
+		int32 Height;
+	};
+	const uint32 FileMagic = 0x49515654;		// 'TVQI' little-endian.
+	const uint32 FileVersion = 1;
+
+	inline int Hash(const uint8* px)																					{ return (px[0]*3 + px[1]*5 + px[2]*7 + px[3]*11) & 63; }
+}
+
+
+void ThumbnailCodec::Encode(std::vector<uint8>& dest, const uint8* pixels, int numPixels)
+{
+	uint8 index[64][4] = { };
+	uint8 prev[4] = { 0, 0, 0, 255 };
+	int run = 0;
+
+	// Worst case is five bytes a pixel. Reserving the typical size avoids most reallocation.
+	dest.reserve(dest.size() + numPixels*2);
+	for (int p = 0; p < numPixels; p++)
+	{
+		const uint8* px = pixels + p*4;
+		if (tMemcmp(px, prev, 4) == 0)
+		{
+			run++;
+			if ((run == MaxRun) || (p == numPixels-1))
+			{
+				dest.push_back(OpRun | uint8(run-1));
+				run = 0;
+			}
+			continue;
+		}
+
+		if (run > 0)
+		{
+			dest.push_back(OpRun | uint8(run-1));
+			run = 0;
+		}
+
+		int hash = Hash(px);
+		if (tMemcmp(index[hash], px, 4) == 0)
+		{
+			dest.push_back(OpIndex | uint8(hash));
+		}
+		else
+		{
+			tMemcpy(index[hash], px, 4);
+			if (px[3] == prev[3])
+			{
+				// Differences wrap, so they are taken as signed 8 bit values.
+				int dr = int8(px[0] - prev[0]);
+				int dg = int8(px[1] - prev[1]);
+				int db = int8(px[2] - prev[2]);
+				int drg = dr - dg;
+				int dbg = db - dg;
+				if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) && (db >= -2) && (db <= 1))
+				{
+					dest.push_back(OpDiff | uint8(((dr+2) << 4) | ((dg+2) << 2) | (db+2)));
+				}
+				else if ((dg >= -32) && (dg <= 31) && (drg >= -8) && (drg <= 7) && (dbg >= -8) && (dbg <= 7))
+				{
+					dest.push_back(OpLuma | uint8(dg+32));
+					dest.push_back(uint8(((drg+8) << 4) | (dbg+8)));
+				}
+				else
+				{
+					dest.push_back(OpRGB);
+					dest.insert(dest.end(), px, px+3);
+				}
+			}
+			else
+			{
+				dest.push_back(OpRGBA);
+				dest.insert(dest.end(), px, px+4);
+			}
+		}
+		tMemcpy(prev, px, 4);
+	}
+}
+
+
+bool ThumbnailCodec::Decode(uint8* pixels, int numPixels, const uint8* src, int srcSize)
+{
+	uint8 index[64][4] = { };
+	uint8 px[4] = { 0, 0, 0, 255 };
+	const uint8* end = src + srcSize;
+	int p = 0;
+	while ((p < numPixels) && (src < end))
+	{
+		uint8 tag = *src++;
+		if (tag == OpRGB)
+		{
+			if (end - src < 3)
+				return false;
+			px[0] = src[0]; px[1] = src[1]; px[2] = src[2];
+			src += 3;
+		}
+		else if (tag == OpRGBA)
+		{
+			if (end - src < 4)
+				return false;
+			tMemcpy(px, src, 4);
+			src += 4;
+		}
+		else switch (tag & OpMask)
+		{
+			case OpIndex:
+				tMemcpy(px, index[tag], 4);
+				break;
+
+			case OpDiff:
+				px[0] += ((tag >> 4) & 3) - 2;
+				px[1] += ((tag >> 2) & 3) - 2;
+				px[2] += ( tag       & 3) - 2;
+				break;
+
+			case OpLuma:
+			{
+				if (src >= end)
+					return false;
+				int dg = (tag & 63) - 32;
+				uint8 rb = *src++;
+				px[0] += dg + ((rb >> 4) & 15) - 8;
+				px[1] += dg;
+				px[2] += dg + (rb & 15) - 8;
+				break;
+			}
+
+			case OpRun:
+			{
+				// The current pixel is written below, so a run of n writes n-1 here.
+				int run = tag & 63;
+				if (p + run >= numPixels)
+					return false;
+				for (int r = 0; r < run; r++, p++)
+					tMemcpy(pixels + p*4, px, 4);
+				break;
+			}
+		}
+
+		tMemcpy(index[Hash(px)], px, 4);
+		tMemcpy(pixels + p*4, px, 4);
+		p++;
+	}
+
+	return (p == numPixels) && (src == end);
+}
+
+
+int ThumbnailCodec::Save(const tString& file, const tPicture& picture)
+{
+	if (!picture.IsValid())
+		return 0;
+
+	std::vector<uint8> data(sizeof(FileHeader));
+	FileHeader header;
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.Width = picture.GetWidth();
+	header.Height = picture.GetHeight();
+	tMemcpy(data.data(), &header, sizeof(FileHeader));
+	Encode(data, (const uint8*)picture.GetPixelPointer(), picture.GetNumPixels());
+
+	if (!tCreateFile(file, data.data(), int(data.size())))
+		return 0;
+
+	return int(data.size());
+}
+
+
+bool ThumbnailCodec::Load(tPicture& picture, const tString& file)
+{
+	int fileSize = 0;
+	uint8* data = tLoadFile(file, nullptr, &fileSize);
+	if (!data)
+		return false;
+
+	FileHeader header;
+	bool ok = fileSize >= int(sizeof(FileHeader));
+	if (ok)
+	{
+		tMemcpy(&header, data, sizeof(FileHeader));
+		ok =
+			(header.Magic == FileMagic) && (header.Version == FileVersion) &&
+			(header.Width > 0) && (header.Width <= MaxDimension) && (header.Height > 0) && (header.Height <= MaxDimension);
+	}
+
+	// The picture takes ownership of the pixels.
+	if (ok)
+	{
+		int numPixels = header.Width * header.Height;
+		tPixel* pixels = new tPixel[numPixels];
+		ok = Decode((uint8*)pixels, numPixels, data + sizeof(FileHeader), fileSize - int(sizeof(FileHeader)));
+		if (ok)
+			picture.Set(header.Width, header.Height, pixels, false);
+		else
+			delete[] pixels;
+	}
+
+	delete[] data;
+	return ok;
+}
@@ -0,0 +1,37 @@
+// ThumbnailCodec.h
+//
+// Lossless compression for cached thumbnails. The format follows QOI, which decodes in a single pass with no tables
+// beyond a 64 entry colour cache.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <vector>
+#include <Foundation/tString.h>
+#include <Image/tPicture.h>
+
+
+namespace ThumbnailCodec
+{
+	// Pixels are 4 bytes each. The encoded stream is appended to dest. Thumbnails are mostly smooth gradients and flat
+	// borders so they typically shrink to a quarter or less.
+	void Encode(std::vector<uint8>& dest, const uint8* pixels, int numPixels);
+
+	// Returns false if the stream is truncated or doesn't decode to exactly numPixels.
+	bool Decode(uint8* pixels, int numPixels, const uint8* src, int srcSize);
+
+	// A cache file is a small header followed by the encoded pixels. Safe to call from any thread. Save returns the
+	// number of bytes written, or 0 if it failed.
+	int Save(const tString& file, const tImage::tPicture&);
+	bool Load(tImage::tPicture&, const tString& file);
+
+	const extern int MaxDimension;		// = 4096;
+}
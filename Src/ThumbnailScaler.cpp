@@ -0,0 +1,222 @@
+// ThumbnailScaler.cpp
+//
+// Fast, good quality downscaling for thumbnail generation. Repeated 2x2 box halving brings large images near the
+// target size cheaply and a separable Lanczos filter does the rest.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <cmath>
+#include <vector>
+#include <Math/tFundamentals.h>
+#include "ThumbnailScaler.h"
+using namespace tMath;
+using namespace tImage;
+
+// SSE2 is part of every x64 target so it needs no build flags or runtime check.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define THUMBNAIL_SCALER_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace ThumbnailScaler
+{
+	struct Taps
+	{
+		int First;						// Source index of the first weight.
+		int Count;
+		int Weights;					// Offset into the weight array.
+	};
+	const float Pi = 3.14159265358979f;
+
+	float Lanczos2(float x);
+	void ComputeTaps(std::vector<Taps>&, std::vector<float>& weights, int srcSize, int destSize);
+}
+
+
+float ThumbnailScaler::Lanczos2(float x)
+{
+	x = tAbs(x);
+	if (x < 1.0e-5f)
+		return 1.0f;
+	if (x >= 2.0f)
+		return 0.0f;
+
+	float px = Pi * x;
+	return 2.0f * std::sin(px) * std::sin(px * 0.5f) / (px * px);
+}
+
+
+void ThumbnailScaler::ComputeTaps(std::vector<Taps>& taps, std::vector<float>& weights, int srcSize, int destSize)
+{
+	float scale = float(srcSize) / float(destSize);
+	float support = 2.0f * scale;
+	taps.resize(destSize);
+	weights.clear();
+	for (int d = 0; d < destSize; d++)
+	{
+		// Source and destination pixel centres line up at the edges.
+		float centre = (float(d) + 0.5f) * scale - 0.5f;
+		int first = tMax(int(std::floor(centre - support)) + 1, 0);
+		int last = tMin(int(std::floor(centre + support)), srcSize - 1);
+
+		Taps& tap = taps[d];
+		tap.First = first;
+		tap.Count = last - first + 1;
+		tap.Weights = int(weights.size());
+
+		float total = 0.0f;
+		for (int s = first; s <= last; s++)
+		{
+			float weight = Lanczos2((float(s) - centre) / scale);
+			weights.push_back(weight);
+			total += weight;
+		}
+
+		// Normalizing also takes care of the taps clipped at the edges.
+		if (total != 0.0f)
+			for (int w = 0; w < tap.Count; w++)
+				weights[tap.Weights + w] /= total;
+	}
+}
+
+
+void ThumbnailScaler::HalveBox(uint8* dest, const uint8* src, int srcWidth, int srcHeight)
+{
+	int destWidth = srcWidth / 2;
+	int destHeight = srcHeight / 2;
+	int srcStride = srcWidth * 4;
+	for (int y = 0; y < destHeight; y++)
+	{
+		const uint8* row0 = src + (2*y) * srcStride;
+		const uint8* row1 = row0 + srcStride;
+		uint8* out = dest + y * destWidth * 4;
+		int x = 0;
+
+		#ifdef THUMBNAIL_SCALER_SSE2
+		// Two destination pixels from four source pixels on each of the two rows. Sums are done in 16 bits so the
+		// rounding matches the scalar path exactly.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		for (; x + 2 <= destWidth; x += 2)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x*8));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x*8));
+			__m128i sumLo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i sumHi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			sumLo = _mm_add_epi16(sumLo, _mm_srli_si128(sumLo, 8));
+			sumHi = _mm_add_epi16(sumHi, _mm_srli_si128(sumHi, 8));
+			__m128i sum = _mm_unpacklo_epi64(sumLo, sumHi);
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			_mm_storel_epi64((__m128i*)(out + x*4), _mm_packus_epi16(sum, zero));
+		}
+		#endif
+
+		for (; x < destWidth; x++)
+		{
+			const uint8* p0 = row0 + x*8;
+			const uint8* p1 = row1 + x*8;
+			for (int c = 0; c < 4; c++)
+				out[x*4 + c] = uint8((p0[c] + p0[c+4] + p1[c] + p1[c+4] + 2) >> 2);
+		}
+	}
+}
+
+
+void ThumbnailScaler::Filter(uint8* dest, int destWidth, int destHeight, const uint8* src, int srcWidth, int srcHeight)
+{
+	std::vector<Taps> tapsX, tapsY;
+	std::vector<float> weightsX, weightsY;
+	ComputeTaps(tapsX, weightsX, srcWidth, destWidth);
+	ComputeTaps(tapsY, weightsY, srcHeight, destHeight);
+
+	// The horizontal pass runs along each source row and the vertical pass combines whole intermediate rows, so both
+	// read memory in order.
+	int rowSize = destWidth * 4;
+	std::vector<float> horiz(size_t(srcHeight) * rowSize);
+	for (int y = 0; y < srcHeight; y++)
+	{
+		const uint8* srcRow = src + y * srcWidth * 4;
+		float* out = horiz.data() + size_t(y) * rowSize;
+		for (int x = 0; x < destWidth; x++)
+		{
+			const Taps& tap = tapsX[x];
+			const float* weight = weightsX.data() + tap.Weights;
+			const uint8* in = srcRow + tap.First * 4;
+			float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+			for (int t = 0; t < tap.Count; t++, in += 4)
+			{
+				r += weight[t] * float(in[0]);
+				g += weight[t] * float(in[1]);
+				b += weight[t] * float(in[2]);
+				a += weight[t] * float(in[3]);
+			}
+			out[x*4 + 0] = r;
+			out[x*4 + 1] = g;
+			out[x*4 + 2] = b;
+			out[x*4 + 3] = a;
+		}
+	}
+
+	std::vector<float> accum(rowSize);
+	for (int y = 0; y < destHeight; y++)
+	{
+		const Taps& tap = tapsY[y];
+		const float* weight = weightsY.data() + tap.Weights;
+		tMemset(accum.data(), 0, rowSize * sizeof(float));
+		for (int t = 0; t < tap.Count; t++)
+		{
+			const float* in = horiz.data() + size_t(tap.First + t) * rowSize;
+			for (int i = 0; i < rowSize; i++)
+				accum[i] += weight[t] * in[i];
+		}
+
+		// Lanczos has negative lobes so results may overshoot a little either way.
+		uint8* out = dest + y * rowSize;
+		for (int i = 0; i < rowSize; i++)
+			out[i] = uint8(tClamp(int(accum[i] + 0.5f), 0, 255));
+	}
+}
+
+
+bool ThumbnailScaler::Downscale(tPicture& picture, int width, int height)
+{
+	int srcW = picture.GetWidth();
+	int srcH = picture.GetHeight();
+	if ((width <= 0) || (height <= 0) || (width > srcW) || (height > srcH))
+		return picture.Resample(width, height, tPicture::tFilter::Bilinear);
+	if ((width == srcW) && (height == srcH))
+		return true;
+
+	// Halving stops while the image is still at least the target size so the final filter always has something to
+	// do, unless the target happens to be an exact power of two smaller.
+	const uint8* curr = (const uint8*)picture.GetPixelPointer();
+	std::vector<uint8> stages[2];
+	int stage = 0;
+	while ((srcW/2 >= width) && (srcH/2 >= height))
+	{
+		stages[stage].resize(size_t(srcW/2) * (srcH/2) * 4);
+		HalveBox(stages[stage].data(), curr, srcW, srcH);
+		curr = stages[stage].data();
+		srcW /= 2;
+		srcH /= 2;
+		stage ^= 1;
+	}
+
+	// The picture takes ownership of the new pixels.
+	tPixel* pixels = new tPixel[width * height];
+	if ((srcW == width) && (srcH == height))
+		tMemcpy(pixels, curr, width * height * 4);
+	else
+		Filter((uint8*)pixels, width, height, curr, srcW, srcH);
+	picture.Set(width, height, pixels, false);
+	return true;
+}
@@ -0,0 +1,34 @@
+// ThumbnailScaler.h
+//
+// Fast, good quality downscaling for thumbnail generation. Repeated 2x2 box halving brings large images near the
+// target size cheaply and a separable Lanczos filter does the rest.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Image/tPicture.h>
+
+
+// All functions work on 4 byte pixels, rows stored one after the other with no padding. Channels are filtered
+// independently, the same as tPicture::Resample. Safe to call from any thread.
+namespace ThumbnailScaler
+{
+	// Resizes the picture in place. Shrinking uses the box stages and the final filter. Anything else, such as an
+	// upscale of a tiny image, is left to tPicture::Resample.
+	bool Downscale(tImage::tPicture&, int width, int height);
+
+	// Averages each 2x2 block. The destination is width/2 by height/2. With an odd width or height the last column or
+	// row is dropped. Uses SSE2 where available.
+	void HalveBox(uint8* dest, const uint8* src, int srcWidth, int srcHeight);
+
+	// A separable Lanczos-2 filter with its support widened by the scale so every source pixel contributes.
+	void Filter(uint8* dest, int destWidth, int destHeight, const uint8* src, int srcWidth, int srcHeight);
+}
@@ -0,0 +1,133 @@
+// TreeScanner.cpp
+//
+// Walks the subdirectories of a folder on a worker thread and streams the image files it finds to the main thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <thread>
+#include <set>
+#include <utility>
+#ifdef PLATFORM_LINUX
+#include <sys/stat.h>
+#endif
+#include "TreeScanner.h"
+#include "DirScan.h"
+
+
+namespace
+{
+	// Identifies a folder by what it is rather than the path it was reached by, so one reached again through a symlink
+	// is recognised. Returns false if there's no id, in which case the folder is walked and only the depth limit holds.
+	bool GetDirID(std::pair<uint64, uint64>& id, const tString& dir)
+	{
+		#ifdef PLATFORM_LINUX
+		struct stat info;
+		if (stat(dir.Chars(), &info) != 0)
+			return false;
+		id = std::make_pair(uint64(info.st_dev), uint64(info.st_ino));
+		return true;
+		#else
+		return false;
+		#endif
+	}
+}
+
+
+void TreeScanner::Start(const tString& rootDir, int maxDepth, const ExtensionSet* extensions)
+{
+	Cancel();
+	Current = std::make_shared<State>();
+
+	// The thread is detached. It holds its own reference to the state so there's nothing to join.
+	std::thread(Walk, Current, rootDir, maxDepth, extensions).detach();
+}
+
+
+void TreeScanner::Cancel()
+{
+	if (!Current)
+		return;
+
+	Current->Cancelled = true;
+	Current.reset();
+}
+
+
+bool TreeScanner::TakeFiles(tList<tStringItem>& files, int maxFiles)
+{
+	if (!Current)
+		return true;
+
+	// Read Done before taking the lock. If it was set, everything the worker found is already in the list.
+	bool done = Current->Done;
+	bool empty = false;
+	{
+		std::lock_guard<std::mutex> lock(Current->Mutex);
+		for (int f = 0; (f < maxFiles) && !Current->Found.IsEmpty(); f++)
+			files.Append(Current->Found.Remove());
+		empty = Current->Found.IsEmpty();
+	}
+
+	if (done && empty)
+	{
+		Current.reset();
+		return true;
+	}
+	return false;
+}
+
+
+void TreeScanner::Walk(std::shared_ptr<State> state, tString rootDir, int maxDepth, const ExtensionSet* extensions)
+{
+	tList<PendingDir> pending;
+	pending.Append(new PendingDir(rootDir, 0));
+	DirScan scan;
+	std::set<std::pair<uint64, uint64>> visited;
+	while (!pending.IsEmpty() && !state->Cancelled)
+	{
+		// Symlinked folders are followed. A link back up the tree, or two links to the same place, would otherwise list
+		// the same files again under other paths, over and over until the depth limit.
+		PendingDir* dir = pending.Remove();
+		std::pair<uint64, uint64> id;
+		if (GetDirID(id, dir->Dir) && !visited.insert(id).second)
+		{
+			delete dir;
+			continue;
+		}
+
+		if (scan.Scan(dir->Dir, extensions))
+		{
+			state->NumDirs++;
+
+			// The root's files are already covered by the normal folder scan.
+			if ((dir->Depth > 0) && (scan.GetNumFiles() > 0))
+			{
+				scan.SortFiles();
+				tList<tStringItem> batch;
+				for (int f = 0; f < scan.GetNumFiles(); f++)
+					batch.Append(new tStringItem(scan.GetFilePath(f)));
+
+				std::lock_guard<std::mutex> lock(state->Mutex);
+				while (!batch.IsEmpty())
+					state->Found.Append(batch.Remove());
+			}
+
+			if (dir->Depth < maxDepth)
+			{
+				for (int d = 0; d < scan.GetNumSubDirs(); d++)
+					pending.Append(new PendingDir(scan.GetDir() + scan.GetSubDirName(d), dir->Depth + 1));
+			}
+		}
+		delete dir;
+	}
+
+	state->Done = true;
+}
@@ -0,0 +1,65 @@
+// TreeScanner.h
+//
+// Walks the subdirectories of a folder on a worker thread and streams the image files it finds to the main thread.
+//
+// Copyright (c) 2020 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+class ExtensionSet;
+
+
+// The walk is breadth-first so shallow folders show up first. Nothing here ever blocks the main thread. Cancelling just
+// flags the worker, which notices between directories and exits on its own. A new walk may be started straight away.
+class TreeScanner
+{
+public:
+	TreeScanner()																										{ }
+	~TreeScanner()																										{ Cancel(); }
+
+	// Starts walking the subdirectories of rootDir down to maxDepth levels. Files directly in rootDir are not reported.
+	// Any walk already in progress is cancelled. The extension set must outlive the walk.
+	void Start(const tString& rootDir, int maxDepth, const ExtensionSet*);
+	void Cancel();
+	bool IsActive() const																								{ return bool(Current); }
+
+	// Moves up to maxFiles of the discovered file paths into files. Returns true once the walk has finished and every
+	// path has been taken, after which IsActive returns false.
+	bool TakeFiles(tList<tStringItem>& files, int maxFiles);
+	int GetNumDirsScanned() const																						{ return Current ? Current->NumDirs.load() : 0; }
+
+private:
+	TreeScanner(const TreeScanner&) = delete;
+	TreeScanner& operator=(const TreeScanner&) = delete;
+
+	// Shared with the worker so a cancelled worker can finish up after the scanner has moved on.
+	struct State
+	{
+		std::mutex Mutex;
+		tList<tStringItem> Found;
+		std::atomic<bool> Cancelled			{ false };
+		std::atomic<bool> Done				{ false };
+		std::atomic<int> NumDirs			{ 0 };
+	};
+	struct PendingDir : public tLink<PendingDir>
+	{
+		PendingDir(const tString& dir, int depth)																		: Dir(dir), Depth(depth) { }
+		tString Dir;
+		int Depth;
+	};
+	static void Walk(std::shared_ptr<State>, tString rootDir, int maxDepth, const ExtensionSet*);
+
+	std::shared_ptr<State> Current;
+};